@@ -0,0 +1,189 @@
+ /** @file
+    Arbiter playing a match between two AI programs without the GUI.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "match.h"
+
+static int usage(char *name) {
+    fprintf(stderr, "Usage: %s -ai1 ai1 -ai2 ai2 [-n n] [-k k] [-p1 x1,y1] [-p2 x2,y2] [-binary] [-timeout ms]"
+                    " [-gui gui [-delay ms]] [-seed seed]\n", name);
+    return 1;
+}
+
+/**
+ * Parses a number from min to INT_MAX.
+ * @return 0, or -1 if text is not such a number.
+ */
+static int parse_number(const char *text, long min, int *value) {
+    char *end;
+    long parsed = strtol(text, &end, 10);
+
+    if (*text < '0' || *text > '9' || *end != '\0' || parsed < min || parsed > INT_MAX) {
+        return -1;
+    }
+
+    *value = (int) parsed;
+    return 0;
+}
+
+/**
+ * Parses a point given as x,y.
+ * @return 0, or -1 if text is not such a point.
+ */
+static int parse_point(const char *text, int *x, int *y) {
+    char *end;
+    long parsed_x = strtol(text, &end, 10);
+
+    if (*text < '1' || *text > '9' || *end != ',' || end[1] < '1' || end[1] > '9' || parsed_x > INT_MAX) {
+        return -1;
+    }
+
+    *x = (int) parsed_x;
+    return parse_number(end + 1, 1, y);
+}
+
+/**
+ * Usage: arbiter -ai1 ai1 -ai2 ai2 [-n n] [-k k] [-p1 x1,y1] [-p2 x2,y2] [-binary] [-timeout ms]
+ *                [-gui gui [-delay ms]] [-seed seed]
+ * Plays a match between two AI programs as game.sh does (n = 10, k = 100 and positions of kings picked
+ * at random by default), relaying their commands at once instead of through fifos, and checking every
+ * command with the engine. AI are command lines, e.g. "./middle_ages -ai mcts".
+ * -binary makes AI exchange binary records (see `BINARY_HANDSHAKE`),
+ * -timeout makes a player thinking longer over a single turn lose,
+ * -gui starts the GUI given, e.g. ./sredniowiecze_gui_with_libs.sh, and shows the match in it,
+ * pausing for -delay ms after every turn,
+ * -seed makes the positions picked the same in every run.
+ * Prints `RESULT winner end rounds commands`, where winner is 0 for a draw, and exits with 0
+ * when the match was played and both AI exited with a result of a game, as game.sh does.
+ */
+int main(int argc, char *argv[]) {
+    match_config config = {{NULL, NULL}, 10, 100, 0, 0, 0, 0, false, 0, -1, 0};
+    match_result result;
+    char *programs[2] = {NULL, NULL};
+    char *gui = NULL;
+    uint64_t seed = (uint64_t) time(NULL) ^ ((uint64_t) getpid() << 32);
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-binary") == 0) {
+            config.binary = true;
+        } else if (i + 1 == argc) {
+            return usage(argv[0]); // all other options have a value
+        } else if (strcmp(argv[i], "-n") == 0) {
+            if (parse_number(argv[++i], 9, &config.n) != 0) {
+                fprintf(stderr, "Parameter \"n\" out of range or not a number.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-k") == 0) {
+            if (parse_number(argv[++i], 1, &config.k) != 0) {
+                fprintf(stderr, "Parameter \"k\" out of range or not a number.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-p1") == 0) {
+            if (parse_point(argv[++i], &config.x1, &config.y1) != 0) {
+                fprintf(stderr, "Parameter \"p1\" is not a correct point coordinate.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-p2") == 0) {
+            if (parse_point(argv[++i], &config.x2, &config.y2) != 0) {
+                fprintf(stderr, "Parameter \"p2\" is not a correct point coordinate.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-ai1") == 0) {
+            programs[0] = argv[++i];
+        } else if (strcmp(argv[i], "-ai2") == 0) {
+            programs[1] = argv[++i];
+        } else if (strcmp(argv[i], "-timeout") == 0) {
+            if (parse_number(argv[++i], 0, &config.turn_timeout_ms) != 0) {
+                fprintf(stderr, "Parameter \"timeout\" out of range or not a number.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-gui") == 0) {
+            gui = argv[++i];
+        } else if (strcmp(argv[i], "-delay") == 0) {
+            if (parse_number(argv[++i], 0, &config.turn_delay_ms) != 0) {
+                fprintf(stderr, "Parameter \"delay\" out of range or not a number.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-seed") == 0) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    if (programs[0] == NULL || programs[1] == NULL) {
+        return usage(argv[0]);
+    }
+
+    if (config.x1 > config.n - 3 || config.y1 > config.n) {
+        fprintf(stderr, "Parameter \"p1\" out of board bounds.\n");
+        return 1;
+    }
+    if (config.x2 > config.n - 3 || config.y2 > config.n) {
+        fprintf(stderr, "Parameter \"p2\" out of board bounds.\n");
+        return 1;
+    }
+    if (pick_start_positions(config.n, &seed, &config.x1, &config.y1, &config.x2, &config.y2) != 0) {
+        fprintf(stderr, "Starting points leave no legal starting point for the other player.\n");
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN); // an AI or the GUI may exit before reading everything
+
+    char **gui_argv = NULL;
+    pid_t gui_pid = -1;
+    if (gui != NULL) {
+        gui_argv = split_program(gui);
+        gui_pid = gui_argv[0] == NULL ? -1 : spawn_program(gui_argv, &config.tee_fd, NULL);
+        if (gui_pid == -1) {
+            fprintf(stderr, "Cannot start the GUI.\n");
+            free(gui_argv);
+            return 1;
+        }
+    }
+
+    char **ai1 = split_program(programs[0]);
+    char **ai2 = split_program(programs[1]);
+    config.programs[0] = ai1;
+    config.programs[1] = ai2;
+
+    int exit_code = 1;
+    if (ai1[0] != NULL && ai2[0] != NULL && play_match(&config, &result) == 0) {
+        printf("RESULT %d %s %d %lld\n", result.winner, match_end_name(result.end), result.rounds, result.commands);
+        exit_code = 0;
+        for (i = 0; i < 2; i++) {
+            if (result.exit_codes[i] < 0 || result.exit_codes[i] > 2) {
+                exit_code = 1;
+            }
+        }
+    } else {
+        fprintf(stderr, "Cannot start the AI.\n");
+    }
+
+    if (gui_pid != -1) {
+        int status;
+        close(config.tee_fd); // the GUI stays open until it is closed by the user
+        waitpid(gui_pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            exit_code = 1;
+        }
+    }
+
+    free(ai1);
+    free(ai2);
+    free(gui_argv);
+    return exit_code;
+}
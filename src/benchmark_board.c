@@ -0,0 +1,114 @@
+ /** @file
+    Boards filled with units for benchmarks.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "benchmark_board.h"
+
+/**
+ * Number of rounds of filled games, more than any board needs to fill up.
+ */
+#define FILL_ROUNDS 1000000
+
+typedef struct def_field {
+    int x;
+    int y;
+} field;
+
+/**
+ * Finds a free field next to (x, y).
+ * @return 0, or -1 when all neighbours are taken.
+ */
+static int free_neighbour(board *game, int x, int y, field *found) {
+    int dx, dy;
+    for (dy = -1; dy <= 1; dy++) {
+        for (dx = -1; dx <= 1; dx++) {
+            int x2 = x + dx;
+            int y2 = y + dy;
+            if (x2 >= 1 && y2 >= 1 && x2 <= game_size(game) && y2 <= game_size(game) &&
+                game_unit_at(game, x2, y2) == NULL) {
+                found->x = x2;
+                found->y = y2;
+                return 0;
+            }
+        }
+    }
+
+    return -1;
+}
+
+int benchmark_board_fill(board *game, int n, int units) {
+    size_t capacity = 64;
+    size_t count = 1;             // peasants which may still have a free neighbour
+    field *peasants;
+    int total = 4;                // the king, a peasant and two knights
+    int result = RESULT_ONGOING;
+
+    if (game_init(game, n, FILL_ROUNDS, 1, 1, 1, 1, n) == RESULT_WRONG_COMMAND) {
+        return -1;
+    }
+
+    peasants = malloc(capacity * sizeof(field));
+    peasants[0].x = 2;
+    peasants[0].y = 1;
+
+    while (total < units && count > 0 && result == RESULT_ONGOING) {
+        size_t waiting = count;   // peasants produced in this turn are put after them
+        size_t kept = 0;
+        size_t i;
+
+        for (i = 0; i < waiting; i++) {
+            field produced;
+            unit *peasant = game_unit_at(game, peasants[i].x, peasants[i].y);
+
+            if (total >= units || game_idle_rounds(game, peasant) < 2) {
+                peasants[kept++] = peasants[i];
+                continue;
+            }
+            if (free_neighbour(game, peasants[i].x, peasants[i].y, &produced) != 0) {
+                continue;         // surrounded for good, as units never leave
+            }
+
+            game_produce_peasant(game, peasants[i].x, peasants[i].y, produced.x, produced.y);
+            total++;
+            peasants[kept++] = peasants[i];
+            if (count == capacity) {
+                capacity *= 2;
+                peasants = realloc(peasants, capacity * sizeof(field));
+            }
+            peasants[count++] = produced;
+        }
+
+        memmove(peasants + kept, peasants + waiting, (count - waiting) * sizeof(field));
+        count = kept + count - waiting;
+
+        result = game_end_turn(game);
+        if (result == RESULT_ONGOING) {
+            result = game_end_turn(game);
+        }
+    }
+
+    free(peasants);
+    return benchmark_board_count(game, 1);
+}
+
+int benchmark_board_count(board *game, int p) {
+    int count = 0;
+    unit *u;
+    for (u = game_units(game, p); u != NULL; u = game_next_unit(game, u)) {
+        count++;
+    }
+
+    return count;
+}
+
+double benchmark_seconds_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
@@ -0,0 +1,32 @@
+ /** @file
+    Interface of boards filled with units for benchmarks.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#ifndef BENCHMARK_BOARD_H
+#define BENCHMARK_BOARD_H
+
+#include "engine.h"
+
+/**
+ * Starts a game on a board of size n, with kings in the corners (1, 1) and (1, n), and lets
+ * peasants of the first player produce peasants on free neighbouring fields, while the second
+ * player only ends turns, until the first player has at least `units` units or the board is full.
+ * Units are added through the engine, so the game is in a state it reaches in a match.
+ * @return number of units of the first player, or -1 when n is too small for the game.
+ */
+int benchmark_board_fill(board *game, int n, int units);
+
+/**
+ * Number of units of player p.
+ */
+int benchmark_board_count(board *game, int p);
+
+/**
+ * Seconds of a monotonic clock.
+ */
+double benchmark_seconds_now();
+
+#endif /* BENCHMARK_BOARD_H */
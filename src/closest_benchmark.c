@@ -0,0 +1,126 @@
+ /** @file
+    Benchmark of the closest unit search.
+
+    For every unit count given, fills a board with about that many units and compares
+    `game_closest_unit`, which searches spatial buckets, against a linear scan of all units
+    from random fields. Both have to find the same unit:
+
+        closest_benchmark [UNITS...]
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmark_board.h"
+#include "engine.h"
+
+#define BUCKET_QUERIES 200000
+#define LINEAR_VISITS 100000000LL // about as many units are visited by linear scans of a measurement
+#define MIN_LINEAR_QUERIES 20
+
+static const int default_counts[] = {1000, 10000, 100000, 1000000};
+
+/**
+ * Next number of a splitmix64 generator with the given state.
+ */
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static int distance(int x1, int y1, int x2, int y2) {
+    int dx = abs(x1 - x2);
+    int dy = abs(y1 - y2);
+    return dx > dy ? dx : dy;
+}
+
+/**
+ * Closest unit of player p to (x, y) found by a scan of all its units, the newest among equally close ones.
+ */
+static unit* closest_linear(board *game, int p, int x, int y) {
+    unit *best = NULL;
+    int best_dist = INT_MAX;
+    unit *u;
+    for (u = game_units(game, p); u != NULL; u = game_next_unit(game, u)) {
+        int dist = distance(x, y, u->x, u->y);
+        if (dist < best_dist) { // the list starts with the newest units
+            best_dist = dist;
+            best = u;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Compares both searches on a board with about `units` units.
+ * @return number of queries for which they found different units.
+ */
+static long long measure(int units) {
+    board *game = game_create();
+    int n = (int) ceil(sqrt(units * 1.5)) + 1;
+    int filled = benchmark_board_fill(game, n < 9 ? 9 : n, units);
+    long long linear_queries = LINEAR_VISITS / filled + MIN_LINEAR_QUERIES;
+    long long mismatches = 0;
+    long long checksum = 0;       // keeps the results in use
+    uint64_t seed = 1;
+    long long i;
+
+    n = game_size(game);
+    double started = benchmark_seconds_now();
+    for (i = 0; i < BUCKET_QUERIES; i++) {
+        uint64_t r = next_random(&seed);
+        checksum += game_closest_unit(game, 1, (int) (r % n) + 1, (int) ((r >> 32) % n) + 1)->id;
+    }
+    double buckets = (benchmark_seconds_now() - started) / BUCKET_QUERIES;
+
+    started = benchmark_seconds_now();
+    for (i = 0; i < linear_queries; i++) {
+        uint64_t r = next_random(&seed);
+        checksum += closest_linear(game, 1, (int) (r % n) + 1, (int) ((r >> 32) % n) + 1)->id;
+    }
+    double linear = (benchmark_seconds_now() - started) / linear_queries;
+
+    seed = 1;
+    for (i = 0; i < linear_queries; i++) {
+        uint64_t r = next_random(&seed);
+        int x = (int) (r % n) + 1;
+        int y = (int) ((r >> 32) % n) + 1;
+        mismatches += game_closest_unit(game, 1, x, y) != closest_linear(game, 1, x, y);
+    }
+
+    printf("units=%d n=%d: buckets %.3f us, linear scan %.3f us per query, %.1fx faster (checksum %lld)\n",
+           filled, n, buckets * 1e6, linear * 1e6, linear / buckets, checksum);
+
+    game_destroy(game);
+    return mismatches;
+}
+
+int main(int argc, char *argv[]) {
+    int counts = argc > 1 ? argc - 1 : (int) (sizeof(default_counts) / sizeof(default_counts[0]));
+    long long mismatches = 0;
+    int i;
+
+    for (i = 0; i < counts; i++) {
+        int units = argc > 1 ? atoi(argv[i + 1]) : default_counts[i];
+        if (units < 1) {
+            fprintf(stderr, "usage: %s [UNITS...]\n", argv[0]);
+            return 1;
+        }
+        mismatches += measure(units);
+    }
+
+    if (mismatches > 0) {
+        fprintf(stderr, "%lld queries found a different unit than the linear scan.\n", mismatches);
+        return 1;
+    }
+
+    return 0;
+}
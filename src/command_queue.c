@@ -0,0 +1,87 @@
+ /** @file
+    Queue of commands passed from one thread to another.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include "command_queue.h"
+
+#define MASK (COMMAND_QUEUE_CAPACITY - 1)
+
+void command_queue_init(command_queue *q) {
+    q->head = 0;
+    q->tail = 0;
+    q->producer_sleeps = 0;
+    q->consumer_sleeps = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wakeup, NULL);
+}
+
+void command_queue_destroy(command_queue *q) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->wakeup);
+}
+
+/**
+ * Wakes up the other side, which has announced it sleeps.
+ */
+static void wake(command_queue *q) {
+    pthread_mutex_lock(&q->lock);
+    pthread_cond_broadcast(&q->wakeup);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/*
+ * A side going to sleep first announces it, then looks at the index of the other side once more;
+ * the other side first moves its index, then looks at the announcement. With both orders kept
+ * (sequentially consistent accesses), at least one of them sees the other, so no wakeup is lost.
+ */
+
+command* command_queue_reserve(command_queue *q) {
+    if (q->tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == COMMAND_QUEUE_CAPACITY) {
+        pthread_mutex_lock(&q->lock);
+        __atomic_store_n(&q->producer_sleeps, 1, __ATOMIC_SEQ_CST);
+        while (q->tail - __atomic_load_n(&q->head, __ATOMIC_SEQ_CST) == COMMAND_QUEUE_CAPACITY) {
+            pthread_cond_wait(&q->wakeup, &q->lock);
+        }
+        __atomic_store_n(&q->producer_sleeps, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&q->lock);
+    }
+
+    return &q->slots[q->tail & MASK];
+}
+
+void command_queue_push(command_queue *q) {
+    __atomic_store_n(&q->tail, q->tail + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->consumer_sleeps, __ATOMIC_SEQ_CST)) {
+        wake(q);
+    }
+}
+
+size_t command_queue_wait(command_queue *q) {
+    size_t ready = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) - q->head;
+
+    if (ready == 0) {
+        pthread_mutex_lock(&q->lock);
+        __atomic_store_n(&q->consumer_sleeps, 1, __ATOMIC_SEQ_CST);
+        while ((ready = __atomic_load_n(&q->tail, __ATOMIC_SEQ_CST) - q->head) == 0) {
+            pthread_cond_wait(&q->wakeup, &q->lock);
+        }
+        __atomic_store_n(&q->consumer_sleeps, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&q->lock);
+    }
+
+    return ready;
+}
+
+command* command_queue_peek(command_queue *q, size_t i) {
+    return &q->slots[(q->head + i) & MASK];
+}
+
+void command_queue_pop(command_queue *q, size_t count) {
+    __atomic_store_n(&q->head, q->head + count, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->producer_sleeps, __ATOMIC_SEQ_CST)) {
+        wake(q);
+    }
+}
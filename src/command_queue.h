@@ -0,0 +1,73 @@
+ /** @file
+    Interface of queue of commands passed from one thread to another.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include "parse.h"
+
+/**
+ * Number of commands the queue holds, a power of two.
+ */
+#define COMMAND_QUEUE_CAPACITY 1024
+
+/**
+ * Ring buffer of commands with a single producer and a single consumer. Both sides only read
+ * the index of the other and write their own, so passing a command takes no lock. A side finding
+ * the queue full or empty goes to sleep on a condition variable, and is woken by the other side
+ * only then, so the lock is taken only when one of the threads has nothing to do anyway.
+ */
+typedef struct def_command_queue {
+    command slots[COMMAND_QUEUE_CAPACITY];
+    size_t head __attribute__((aligned(64))); // next command to be read, written by the consumer
+    size_t tail __attribute__((aligned(64))); // next free slot, written by the producer
+    int producer_sleeps __attribute__((aligned(64)));
+    int consumer_sleeps;
+    pthread_mutex_t lock;         // taken only to sleep and to wake the other side up
+    pthread_cond_t wakeup;
+} command_queue;
+
+/**
+ * Prepares an empty queue.
+ */
+void command_queue_init(command_queue *q);
+
+/**
+ * Frees resources of the queue. No thread may use it anymore.
+ */
+void command_queue_destroy(command_queue *q);
+
+/**
+ * Producer: returns the slot for the next command, waiting while the queue is full.
+ * The command becomes visible to the consumer with `command_queue_push`.
+ */
+command* command_queue_reserve(command_queue *q);
+
+/**
+ * Producer: hands the command written to the reserved slot over to the consumer.
+ */
+void command_queue_push(command_queue *q);
+
+/**
+ * Consumer: waits until the queue is not empty and returns the number of commands ready,
+ * which can all be read with `command_queue_peek` before a single `command_queue_pop`.
+ */
+size_t command_queue_wait(command_queue *q);
+
+/**
+ * Consumer: i-th of the ready commands, the oldest first.
+ */
+command* command_queue_peek(command_queue *q, size_t i);
+
+/**
+ * Consumer: gives the count oldest commands back to the producer.
+ */
+void command_queue_pop(command_queue *q, size_t count);
+
+#endif /* COMMAND_QUEUE_H */
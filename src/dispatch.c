@@ -0,0 +1,96 @@
+ /** @file
+    Execution of protocol commands.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include "dispatch.h"
+
+/**
+ * Lets AI move when the game goes on and it is its turn.
+ */
+static int after_turn_change(board *game, int exit_code) {
+	if (exit_code == RESULT_ONGOING && game_ai_turn(game)) {
+		exit_code = game_ai_make_move(game);
+	}
+
+	return exit_code;
+}
+
+static int execute_wrong(board *game, command *new_command) {
+	return RESULT_WRONG_COMMAND;
+}
+
+static int execute_init(board *game, command *new_command) {
+	return after_turn_change(game, game_init(game,
+											 new_command->data[0],
+											 new_command->data[1],
+											 new_command->data[2],
+											 new_command->data[3],
+											 new_command->data[4],
+											 new_command->data[5],
+											 new_command->data[6]));
+}
+
+static int execute_move(board *game, command *new_command) {
+	return game_move(game,
+					 new_command->data[0],
+					 new_command->data[1],
+					 new_command->data[2],
+					 new_command->data[3]);
+}
+
+static int execute_produce_knight(board *game, command *new_command) {
+	return game_produce_knight(game,
+							   new_command->data[0],
+							   new_command->data[1],
+							   new_command->data[2],
+							   new_command->data[3]);
+}
+
+static int execute_produce_peasant(board *game, command *new_command) {
+	return game_produce_peasant(game,
+								new_command->data[0],
+								new_command->data[1],
+								new_command->data[2],
+								new_command->data[3]);
+}
+
+static int execute_end_turn(board *game, command *new_command) {
+	return after_turn_change(game, game_end_turn(game));
+}
+
+/**
+ * Executing function of every opcode.
+ */
+static int (*const executors[OPCODE_COUNT])(board *game, command *new_command) = {
+	[OPCODE_WRONG] = execute_wrong,
+	[OPCODE_INIT] = execute_init,
+	[OPCODE_MOVE] = execute_move,
+	[OPCODE_PRODUCE_KNIGHT] = execute_produce_knight,
+	[OPCODE_PRODUCE_PEASANT] = execute_produce_peasant,
+	[OPCODE_END_TURN] = execute_end_turn
+};
+
+int execute_command(board *game, command *new_command) {
+	return executors[new_command->opcode](game, new_command);
+}
+
+int apply_command(board *game, command *new_command) {
+	switch (new_command->opcode) {
+		case OPCODE_INIT:
+			return game_init(game,
+							 new_command->data[0],
+							 new_command->data[1],
+							 new_command->data[2],
+							 new_command->data[3],
+							 new_command->data[4],
+							 new_command->data[5],
+							 new_command->data[6]);
+		case OPCODE_END_TURN:
+			return game_end_turn(game);
+		default:
+			return executors[new_command->opcode](game, new_command);
+	}
+}
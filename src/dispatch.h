@@ -0,0 +1,27 @@
+ /** @file
+    Interface of execution of protocol commands.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "engine.h"
+#include "parse.h"
+
+/**
+ * Executes a parsed command on the given game and, when it becomes AI's turn, lets AI move.
+ * @return state of the game afterwards; `RESULT_WRONG_COMMAND` for `OPCODE_WRONG`.
+ */
+int execute_command(board *game, command *new_command);
+
+/**
+ * Executes a parsed command on the given game, never letting AI move, as an arbiter
+ * checking commands of both players does.
+ * @return state of the game afterwards, from the point of view of the player given by INIT.
+ */
+int apply_command(board *game, command *new_command);
+
+#endif /* DISPATCH_H */
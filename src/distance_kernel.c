@@ -0,0 +1,187 @@
+ /** @file
+    Vectorized distance scans over arrays of coordinates.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <limits.h>
+#include <stdlib.h>
+#include "distance_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+static int distance(int x1, int y1, int x2, int y2) {
+    int dx = abs(x1 - x2);
+    int dy = abs(y1 - y2);
+    return dx > dy ? dx : dy;
+}
+
+static int min_distance_scalar(const int *xs, const int *ys, unsigned int from, unsigned int n, int x, int y) {
+    int min_dist = INT_MAX;
+    unsigned int i;
+    for (i = from; i < n; i++) {
+        int dist = distance(xs[i], ys[i], x, y);
+        min_dist = dist < min_dist ? dist : min_dist;
+    }
+    return min_dist;
+}
+
+static unsigned int max_id_scalar(const int *xs, const int *ys, const unsigned int *ids, unsigned int from,
+                                  unsigned int n, int x, int y, int dist) {
+    unsigned int newest = 0;
+    unsigned int i;
+    for (i = from; i < n; i++) {
+        unsigned int candidate = distance(xs[i], ys[i], x, y) == dist ? ids[i] : 0;
+        newest = candidate > newest ? candidate : newest;
+    }
+    return newest;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+__attribute__((target("avx2")))
+static int min_distance_avx2(const int *xs, const int *ys, unsigned int n, int x, int y) {
+    __m256i vx = _mm256_set1_epi32(x);
+    __m256i vy = _mm256_set1_epi32(y);
+    __m256i vmin = _mm256_set1_epi32(INT_MAX);
+    unsigned int i;
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i dx = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (xs + i)), vx));
+        __m256i dy = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (ys + i)), vy));
+        vmin = _mm256_min_epi32(vmin, _mm256_max_epi32(dx, dy));
+    }
+
+    __m128i m = _mm_min_epi32(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    int min_dist = _mm_cvtsi128_si32(m);
+    int tail = min_distance_scalar(xs, ys, i, n, x, y);
+    return tail < min_dist ? tail : min_dist;
+}
+
+__attribute__((target("avx2")))
+static unsigned int max_id_avx2(const int *xs, const int *ys, const unsigned int *ids, unsigned int n,
+                                int x, int y, int dist) {
+    __m256i vx = _mm256_set1_epi32(x);
+    __m256i vy = _mm256_set1_epi32(y);
+    __m256i vdist = _mm256_set1_epi32(dist);
+    __m256i vmax = _mm256_setzero_si256();
+    unsigned int i;
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i dx = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (xs + i)), vx));
+        __m256i dy = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) (ys + i)), vy));
+        __m256i hit = _mm256_cmpeq_epi32(_mm256_max_epi32(dx, dy), vdist);
+        __m256i candidate = _mm256_and_si256(hit, _mm256_loadu_si256((const __m256i *) (ids + i)));
+        vmax = _mm256_max_epu32(vmax, candidate);
+    }
+
+    __m128i m = _mm_max_epu32(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+    m = _mm_max_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    unsigned int newest = (unsigned int) _mm_cvtsi128_si32(m);
+    unsigned int tail = max_id_scalar(xs, ys, ids, i, n, x, y, dist);
+    return tail > newest ? tail : newest;
+}
+
+__attribute__((target("sse4.1")))
+static int min_distance_sse41(const int *xs, const int *ys, unsigned int n, int x, int y) {
+    __m128i vx = _mm_set1_epi32(x);
+    __m128i vy = _mm_set1_epi32(y);
+    __m128i vmin = _mm_set1_epi32(INT_MAX);
+    unsigned int i;
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i dx = _mm_abs_epi32(_mm_sub_epi32(_mm_loadu_si128((const __m128i *) (xs + i)), vx));
+        __m128i dy = _mm_abs_epi32(_mm_sub_epi32(_mm_loadu_si128((const __m128i *) (ys + i)), vy));
+        vmin = _mm_min_epi32(vmin, _mm_max_epi32(dx, dy));
+    }
+
+    vmin = _mm_min_epi32(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmin = _mm_min_epi32(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(2, 3, 0, 1)));
+    int min_dist = _mm_cvtsi128_si32(vmin);
+    int tail = min_distance_scalar(xs, ys, i, n, x, y);
+    return tail < min_dist ? tail : min_dist;
+}
+
+__attribute__((target("sse4.1")))
+static unsigned int max_id_sse41(const int *xs, const int *ys, const unsigned int *ids, unsigned int n,
+                                 int x, int y, int dist) {
+    __m128i vx = _mm_set1_epi32(x);
+    __m128i vy = _mm_set1_epi32(y);
+    __m128i vdist = _mm_set1_epi32(dist);
+    __m128i vmax = _mm_setzero_si128();
+    unsigned int i;
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i dx = _mm_abs_epi32(_mm_sub_epi32(_mm_loadu_si128((const __m128i *) (xs + i)), vx));
+        __m128i dy = _mm_abs_epi32(_mm_sub_epi32(_mm_loadu_si128((const __m128i *) (ys + i)), vy));
+        __m128i hit = _mm_cmpeq_epi32(_mm_max_epi32(dx, dy), vdist);
+        __m128i candidate = _mm_and_si128(hit, _mm_loadu_si128((const __m128i *) (ids + i)));
+        vmax = _mm_max_epu32(vmax, candidate);
+    }
+
+    vmax = _mm_max_epu32(vmax, _mm_shuffle_epi32(vmax, _MM_SHUFFLE(1, 0, 3, 2)));
+    vmax = _mm_max_epu32(vmax, _mm_shuffle_epi32(vmax, _MM_SHUFFLE(2, 3, 0, 1)));
+    unsigned int newest = (unsigned int) _mm_cvtsi128_si32(vmax);
+    unsigned int tail = max_id_scalar(xs, ys, ids, i, n, x, y, dist);
+    return tail > newest ? tail : newest;
+}
+
+#endif /* HAVE_X86_KERNELS */
+
+bool distance_kernel_supported(enum DistanceKernel kernel) {
+#ifdef HAVE_X86_KERNELS
+    if (kernel == KERNEL_AVX2) {
+        return __builtin_cpu_supports("avx2");
+    } else if (kernel == KERNEL_SSE41) {
+        return __builtin_cpu_supports("sse4.1");
+    }
+#endif
+    return kernel == KERNEL_SCALAR;
+}
+
+/**
+ * The fastest kernel supported by the processor.
+ */
+static enum DistanceKernel best_kernel() {
+    if (distance_kernel_supported(KERNEL_AVX2)) {
+        return KERNEL_AVX2;
+    } else if (distance_kernel_supported(KERNEL_SSE41)) {
+        return KERNEL_SSE41;
+    }
+    return KERNEL_SCALAR;
+}
+
+int min_distance_with(enum DistanceKernel kernel, const int *xs, const int *ys, unsigned int n, int x, int y) {
+#ifdef HAVE_X86_KERNELS
+    if (kernel == KERNEL_AVX2) {
+        return min_distance_avx2(xs, ys, n, x, y);
+    } else if (kernel == KERNEL_SSE41) {
+        return min_distance_sse41(xs, ys, n, x, y);
+    }
+#endif
+    return min_distance_scalar(xs, ys, 0, n, x, y);
+}
+
+unsigned int max_id_at_distance_with(enum DistanceKernel kernel, const int *xs, const int *ys,
+                                     const unsigned int *ids, unsigned int n, int x, int y, int dist) {
+#ifdef HAVE_X86_KERNELS
+    if (kernel == KERNEL_AVX2) {
+        return max_id_avx2(xs, ys, ids, n, x, y, dist);
+    } else if (kernel == KERNEL_SSE41) {
+        return max_id_sse41(xs, ys, ids, n, x, y, dist);
+    }
+#endif
+    return max_id_scalar(xs, ys, ids, 0, n, x, y, dist);
+}
+
+int min_distance(const int *xs, const int *ys, unsigned int n, int x, int y) {
+    return min_distance_with(best_kernel(), xs, ys, n, x, y);
+}
+
+unsigned int max_id_at_distance(const int *xs, const int *ys, const unsigned int *ids, unsigned int n,
+                                int x, int y, int dist) {
+    return max_id_at_distance_with(best_kernel(), xs, ys, ids, n, x, y, dist);
+}
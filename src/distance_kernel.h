@@ -0,0 +1,51 @@
+ /** @file
+    Interface of vectorized distance scans over arrays of coordinates.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef DISTANCE_KERNEL_H
+#define DISTANCE_KERNEL_H
+
+#include <stdbool.h>
+
+/**
+ * Implementations of the scans, the fastest supported one is used by default.
+ */
+enum DistanceKernel {
+    KERNEL_SCALAR = 0,
+    KERNEL_SSE41 = 1,
+    KERNEL_AVX2 = 2
+};
+
+/**
+ * Returns the smallest distance in an infinity norm between (x, y) and (xs[i], ys[i]), i < n.
+ * n has to be positive. Uses AVX2 or SSE4.1 when the processor supports them.
+ */
+int min_distance(const int *xs, const int *ys, unsigned int n, int x, int y);
+
+/**
+ * Returns the biggest ids[i] among i < n such that (xs[i], ys[i]) is exactly dist away from (x, y),
+ * or 0 if there is no such i.
+ */
+unsigned int max_id_at_distance(const int *xs, const int *ys, const unsigned int *ids, unsigned int n,
+                                int x, int y, int dist);
+
+/**
+ * Whether the processor supports kernel.
+ */
+bool distance_kernel_supported(enum DistanceKernel kernel);
+
+/**
+ * `min_distance` computed by the given kernel, which has to be supported.
+ */
+int min_distance_with(enum DistanceKernel kernel, const int *xs, const int *ys, unsigned int n, int x, int y);
+
+/**
+ * `max_id_at_distance` computed by the given kernel, which has to be supported.
+ */
+unsigned int max_id_at_distance_with(enum DistanceKernel kernel, const int *xs, const int *ys,
+                                     const unsigned int *ids, unsigned int n, int x, int y, int dist);
+
+#endif /* DISTANCE_KERNEL_H */
@@ -0,0 +1,191 @@
+ /** @file
+    Benchmark of the distance kernels.
+
+    Checks that every kernel supported by the processor finds the same closest unit as the
+    scalar one, the newest among equally close ones, on arrays full of ties and of lengths
+    not divisible by the vector width. Then times the scans finding the closest unit
+    (`min_distance_with` and `max_id_at_distance_with`) for a range of array lengths:
+
+        distance_kernel_benchmark [LENGTH...]
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "distance_kernel.h"
+
+#define CHECKED_LENGTHS 70        // every length from 1 is checked
+#define CHECKS_PER_LENGTH 200
+#define TIE_RANGE 6               // coordinates of checked arrays are so close that most distances tie
+#define BOARD_SIZE 1000
+#define VISITS 200000000LL        // about as many units are scanned by every kernel in a measurement
+#define MIN_QUERIES 10
+
+static const int default_lengths[] = {16, 256, 4096, 65536, 1048576};
+static const char *kernel_names[] = {"scalar", "sse4.1", "avx2"};
+
+static uint64_t seed = 1;
+
+/**
+ * Next number of a splitmix64 generator.
+ */
+static uint64_t next_random() {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double seconds_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Fills arrays of n units with coordinates from 1 to range and distinct ids in random order.
+ */
+static void fill(int *xs, int *ys, unsigned int *ids, unsigned int n, int range) {
+    unsigned int i;
+    for (i = 0; i < n; i++) {
+        xs[i] = (int) (next_random() % range) + 1;
+        ys[i] = (int) (next_random() % range) + 1;
+        ids[i] = i + 1;
+    }
+    for (i = n - 1; i > 0; i--) {
+        unsigned int j = (unsigned int) (next_random() % (i + 1));
+        unsigned int id = ids[i];
+        ids[i] = ids[j];
+        ids[j] = id;
+    }
+}
+
+/**
+ * Id of the closest unit to (x, y) found by the kernel, the newest among equally close ones.
+ */
+static unsigned int closest(enum DistanceKernel kernel, const int *xs, const int *ys, const unsigned int *ids,
+                            unsigned int n, int x, int y) {
+    int dist = min_distance_with(kernel, xs, ys, n, x, y);
+    return max_id_at_distance_with(kernel, xs, ys, ids, n, x, y, dist);
+}
+
+/**
+ * Id of the closest unit found by a plain loop, to check the kernels against.
+ */
+static unsigned int closest_reference(const int *xs, const int *ys, const unsigned int *ids, unsigned int n,
+                                      int x, int y) {
+    int best_dist = INT_MAX;
+    unsigned int best = 0;
+    unsigned int i;
+    for (i = 0; i < n; i++) {
+        int dx = abs(xs[i] - x);
+        int dy = abs(ys[i] - y);
+        int dist = dx > dy ? dx : dy;
+        if (dist < best_dist || (dist == best_dist && ids[i] > best)) {
+            best_dist = dist;
+            best = ids[i];
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Checks all supported kernels against the reference on arrays full of ties.
+ * @return number of queries for which some kernel found a different unit.
+ */
+static long long check_kernels() {
+    int xs[CHECKED_LENGTHS];
+    int ys[CHECKED_LENGTHS];
+    unsigned int ids[CHECKED_LENGTHS];
+    long long mismatches = 0;
+    unsigned int n;
+    int i, kernel;
+
+    for (n = 1; n <= CHECKED_LENGTHS; n++) {
+        for (i = 0; i < CHECKS_PER_LENGTH; i++) {
+            fill(xs, ys, ids, n, TIE_RANGE);
+            int x = (int) (next_random() % (TIE_RANGE + 2));
+            int y = (int) (next_random() % (TIE_RANGE + 2));
+            unsigned int expected = closest_reference(xs, ys, ids, n, x, y);
+            for (kernel = KERNEL_SCALAR; kernel <= KERNEL_AVX2; kernel++) {
+                if (distance_kernel_supported(kernel) && closest(kernel, xs, ys, ids, n, x, y) != expected) {
+                    fprintf(stderr, "%s kernel finds a different unit among %u\n", kernel_names[kernel], n);
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+/**
+ * Times all supported kernels on n units.
+ */
+static void measure(unsigned int n) {
+    int *xs = malloc(n * sizeof(int));
+    int *ys = malloc(n * sizeof(int));
+    unsigned int *ids = malloc(n * sizeof(unsigned int));
+    long long queries = VISITS / n + MIN_QUERIES;
+    double scalar = 0;
+    int kernel;
+
+    fill(xs, ys, ids, n, BOARD_SIZE);
+    printf("length %u:", n);
+    for (kernel = KERNEL_SCALAR; kernel <= KERNEL_AVX2; kernel++) {
+        unsigned long long checksum = 0; // keeps the results in use
+        uint64_t query_seed = 7;
+        long long i;
+
+        if (!distance_kernel_supported(kernel)) {
+            printf(" %s unsupported", kernel_names[kernel]);
+            continue;
+        }
+
+        double started = seconds_now();
+        for (i = 0; i < queries; i++) {
+            query_seed = query_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            checksum += closest(kernel, xs, ys, ids, n, (int) ((query_seed >> 33) % BOARD_SIZE) + 1,
+                                (int) ((query_seed >> 13) % BOARD_SIZE) + 1);
+        }
+        double elapsed = (seconds_now() - started) / queries;
+        if (kernel == KERNEL_SCALAR) {
+            scalar = elapsed;
+        }
+
+        printf(" %s %.3f us (%.1fx, checksum %llu)", kernel_names[kernel], elapsed * 1e6, scalar / elapsed, checksum);
+    }
+    printf("\n");
+
+    free(xs);
+    free(ys);
+    free(ids);
+}
+
+int main(int argc, char *argv[]) {
+    int lengths = argc > 1 ? argc - 1 : (int) (sizeof(default_lengths) / sizeof(default_lengths[0]));
+    long long mismatches = check_kernels();
+    int i;
+
+    for (i = 0; i < lengths; i++) {
+        int n = argc > 1 ? atoi(argv[i + 1]) : default_lengths[i];
+        if (n < 1) {
+            fprintf(stderr, "usage: %s [LENGTH...]\n", argv[0]);
+            return 1;
+        }
+        measure((unsigned int) n);
+    }
+
+    if (mismatches > 0) {
+        fprintf(stderr, "%lld queries found a different unit than the reference.\n", mismatches);
+        return 1;
+    }
+
+    return 0;
+}
@@ -12,113 +12,453 @@
 
 #include <limits.h>
 #include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include "engine.h"
 #include "print.h"
+#include "unit_index.h"
+#include "unit_pool.h"
+#include "player_units.h"
+#include "search.h"
+#include "mcts.h"
+#include "transposition.h"
 
 #define MIN(a, b) (((a)<(b))?(a):(b))
 #define MAX(a, b) (((a)>(b))?(a):(b))
 
-typedef struct def_board {
-    unit *head;					  // list of units
+#define INITIAL_UNDO_CAPACITY 64
+#define INITIAL_UNIT_CAPACITY 64
+#define TT_SIZE_LOG2 16           // entries of the transposition table of the search AI, 16 bytes each
+
+#define SIDE_KEY 0x9e3779b97f4a7c15ULL    // in the hash when the second player is to move
+#define ROUNDS_SALT 0x2545f4914f6cdd1dULL
+
+enum UndoKind {
+    UNDO_MOVE,
+    UNDO_PRODUCE,
+    UNDO_END_TURN
+};
+
+/**
+ * Everything needed to take back one action made by `game_make_*`.
+ */
+typedef struct def_undo_record {
+    enum UndoKind kind;
+    int mover;                    // number of moved unit or producing peasant
+    int destination;              // unit standing on the destination field before the move
+    int produced;                 // unit created by the production
+    int killed[2];                // units killed in a fight, in order of their deaths
+    int killed_count;
+    int x1, y1, x2, y2;
+    int idle_since;               // of mover before the action
+    int cell_prev, cell_next;     // links of mover in the buckets of its player before the action
+    int turn;
+    int number_of_rounds_left;
+    uint64_t hash;
+} undo_record;
+
+/**
+ * Whole state of a match in a single buffer: this header, then the units, the index of their
+ * positions and arrays of units of both players. Units refer to each other by numbers and the few
+ * pointers of the header are set by `bind_state` from offsets, so a memcpy of the buffer is a copy
+ * of the match. The buffer grows only at the end of a turn (see `reserve_units`), so pointers to units
+ * stay valid for the whole turn.
+ */
+typedef struct def_game_state {
+    size_t bytes;                 // size of the buffer
+    unsigned int capacity;        // number of units fitting in the buffer
+    size_t index_offset;          // where parts of the buffer start, units are right after the header
+    size_t units_offset[2];
+    unit_pool pool;               // memory of units
+    unit_index index;             // units by their position
+    player_units units[2];        // units of both players as arrays
+    int heads[2];                 // lists of units of both players, the newest first
     int size;				      // size of a board
     int number_of_rounds_left;    // number of rounds to finish the game
     int turn;                     // in {1,2} as first or second player
     int this_player;              // in {1,2} as which player we are playing as
     bool built_peasant;           // 1 peasant has been built by ai
-} board;
+    unsigned int ai_epoch;        // number of turns made by ai
+    unsigned int next_unit_id;    // id of the next created unit
+    uint64_t hash;                // Zobrist hash of the position, see `unit_key`
+} game_state;
+
+struct def_board {
+    bool initialized;             // false before INIT and after the game has been cleared
+    output *out;                  // where AI prints its commands, NULL means stdout
+    ai_options ai;                // which AI plays
+    game_state *state;            // the match, NULL when not initialized
+    size_t state_capacity;        // bytes allocated for state
+    unsigned long state_growths;  // number of times the state has been moved to a bigger buffer
+    undo_record *undo_log;        // actions made by `game_make_*`, the latest last
+    size_t undo_count;
+    size_t undo_capacity;
+    undo_record *recording;       // action being made; its killed units are kept instead of freed
+    transposition_table tt;       // of the search AI, allocated on its first turn
+    int ai_cancelled;             // a `CancelState`, raised by `game_cancel_ai`, taken by the thinking AI
+    struct def_ponder *ponder;    // search running while the opponent moves, NULL when there is none
+};
+
+/**
+ * Search of the AI running on a background thread during the turn of its opponent.
+ */
+typedef struct def_ponder {
+    board *copy;                  // the game after the last turn of the AI
+    transposition_table *tt;      // of the game, where results are left
+    pthread_t thread;
+} ponder;
 
-static board* game; // global variable (common for all functions in engine.c)
+static unit* find_unit(board *game, int x1, int y1);
 
-void start_game() {
-    game = NULL;
+/**
+* Evaluates which one player is an owner of unit u.
+*/
+static int player(unit* u);
+
+static int is_not_peasant(unit *pawn);
+
+board* game_create() {
+    board *game = malloc(sizeof(board));
+    game->initialized = false;
+    game->state = NULL;
+    game->state_capacity = 0;
+    game->out = NULL;
+    game->ai.kind = AI_GREEDY;
+    game->ai.budget_ms = 0;
+    game->ai.workers = 1;
+    game->ai.ponder = false;
+    game->tt.entries = NULL;
+    game->ai_cancelled = CANCEL_NONE;
+    game->ponder = NULL;
+    return game;
+}
+
+void game_set_output(board *game, output *out) {
+    game->out = out;
 }
 
-int game_is_not_initialized() {
-    return (game == NULL);
+void game_set_ai(board *game, const ai_options *options) {
+    game->ai = *options;
 }
 
+int game_is_not_initialized(board *game) {
+    return !game->initialized;
+}
+
+static void stop_pondering(board *game);
+
 /**
- * Frees memory.
+ * Frees memory. All units go away together with the buffer of the state.
  */
-void end_game() {
-    if (game_is_not_initialized()) {
+void game_clear(board *game) {
+    if (game_is_not_initialized(game)) {
         return;
     }
 
-    unit *unit_iterator = game->head;
+    stop_pondering(game);
 
-    if (unit_iterator == NULL) {
-        free(game);
-        game = NULL;
-        return;
-    }
+#ifdef ENGINE_POOL_STATS
+    fprintf(stderr, "unit pool: %lu state buffer growths, %lu units acquired, %lu released\n",
+            game->state_growths, game->state->pool.acquired, game->state->pool.released);
+#endif
 
-    unit *unit_temp;
-    while (unit_iterator->next != NULL) {
-        unit_temp = unit_iterator;
-        unit_iterator = unit_iterator->next;
-        free(unit_temp);
-    }
+    free(game->state);
+    game->state = NULL;
+    game->state_capacity = 0;
+    free(game->undo_log);
+    tt_free(&game->tt);
+    game->initialized = false;
+}
 
-    free(unit_iterator);
+void game_destroy(board *game) {
+    game_clear(game);
     free(game);
-    game = NULL;
 }
 
-static int wrong_command_exit() {
-    end_game();
+static int wrong_command_exit(board *game) {
+    game_clear(game);
     return RESULT_WRONG_COMMAND;
 }
 
-static board *new_board(int n, int k, int p) {
-    board *new_board = malloc(sizeof(board));
-    new_board->head = NULL;
-    new_board->size = n;
-    new_board->number_of_rounds_left = k;
-    new_board->this_player = p;
-    new_board->turn = 1;
-    new_board->built_peasant = false;
+/**
+ * Unit number i of the game, NULL for `NO_UNIT`.
+ */
+static unit* unit_number(board *game, int i) {
+    return i == NO_UNIT ? NULL : &game->state->pool.units[i];
+}
+
+/**
+ * Number of unit u, `NO_UNIT` for NULL.
+ */
+static int number_of(board *game, unit *u) {
+    return u == NULL ? NO_UNIT : (int) (u - game->state->pool.units);
+}
+
+/**
+ * Finalizer of splitmix64.
+ */
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
 
-    return new_board;
+/**
+ * Key of unit u. The hash of a position is the xor of keys of all its units, `rounds_key`
+ * and `SIDE_KEY` when the second player is to move.
+ * Boards are too large for tables of random keys, so keys are mixed from the type, the field
+ * and the round the unit is idle since. That round is absolute, so keys do not change
+ * when a round ends and only the units that act are rehashed.
+ */
+static uint64_t unit_key(unit *u) {
+    uint64_t field = ((uint64_t) (uint32_t) u->x << 32) | (uint32_t) u->y;
+    return mix(mix(field) ^ ((uint64_t) (uint32_t) u->idle_since << 8 | (uint64_t) (unsigned char) u->type));
+}
+
+static uint64_t rounds_key(int number_of_rounds_left) {
+    return mix((uint64_t) (uint32_t) number_of_rounds_left ^ ROUNDS_SALT);
+}
+
+/**
+ * Adds unit u, as it is now, to the hash or takes it out.
+ */
+static void toggle_unit(board *game, unit *u) {
+    game->state->hash ^= unit_key(u);
 }
 
-static unit* find_unit(int x1, int y1) {
-    unit *unit_iterator = game->head;
-    while (unit_iterator != NULL) {
-        if (unit_iterator->x == x1 && unit_iterator->y == y1) {
-            return unit_iterator;
+#ifdef ENGINE_CROSS_CHECK
+/**
+ * Computes the hash of the position anew. Kept as a reference for the incremental one.
+ */
+static uint64_t hash_from_scratch(board *game) {
+    uint64_t hash = rounds_key(game->state->number_of_rounds_left) ^ (game->state->turn == 2 ? SIDE_KEY : 0);
+    int i;
+    for (i = 0; i < 2; i++) {
+        unit *u;
+        for (u = unit_number(game, game->state->heads[i]); u != NULL; u = unit_number(game, u->next)) {
+            hash ^= unit_key(u);
         }
+    }
+
+    return hash;
+}
+#endif
+
+/**
+ * Passes result on, ending the game if it is `RESULT_WRONG_COMMAND`.
+ */
+static int checked(board *game, int result) {
+#ifdef ENGINE_CROSS_CHECK
+    assert(result == RESULT_WRONG_COMMAND || game->state->hash == hash_from_scratch(game));
+#endif
+
+    return result == RESULT_WRONG_COMMAND ? wrong_command_exit(game) : result;
+}
+
+/**
+ * Number of bytes rounded up to a multiple of 8.
+ */
+static size_t aligned(size_t bytes) {
+    return (bytes + 7) & ~(size_t) 7;
+}
+
+/**
+ * Sets size and offsets of parts of the buffer of state for capacity units on a board of size n.
+ */
+static void lay_out(game_state *state, int n, unsigned int capacity) {
+    state->capacity = capacity;
+    state->index_offset = aligned(sizeof(game_state)) + aligned(capacity * sizeof(unit));
+    state->units_offset[0] = state->index_offset + unit_index_bytes(n, capacity);
+    state->units_offset[1] = state->units_offset[0] + player_units_bytes(n, capacity);
+    state->bytes = state->units_offset[1] + player_units_bytes(n, capacity);
+}
+
+/**
+ * Array of units in the buffer of state.
+ */
+static unit* units_of(game_state *state) {
+    return (unit *) ((char *) state + aligned(sizeof(game_state)));
+}
 
-        unit_iterator = unit_iterator->next;
+/**
+ * Points the state to parts of its own buffer, after the buffer has been copied.
+ */
+static void bind_state(game_state *state) {
+    char *base = (char *) state;
+    unit_pool_bind(&state->pool, units_of(state), state->capacity);
+    unit_index_bind(&state->index, base + state->index_offset);
+    player_units_bind(&state->units[0], units_of(state), base + state->units_offset[0]);
+    player_units_bind(&state->units[1], units_of(state), base + state->units_offset[1]);
+}
+
+/**
+ * Moves the state to a new buffer for capacity units.
+ */
+static void grow_state(board *game, unsigned int capacity) {
+    game_state *old = game->state;
+    game_state *state = malloc(sizeof(game_state));
+    int i;
+
+    *state = *old;
+    lay_out(state, old->size, capacity);
+    state = realloc(state, state->bytes);
+    char *base = (char *) state;
+
+    memcpy(units_of(state), units_of(old), old->pool.used * sizeof(unit));
+    unit_pool_bind(&state->pool, units_of(state), capacity);
+    unit_index_copy(&state->index, &old->index, capacity, base + state->index_offset);
+    for (i = 0; i < 2; i++) {
+        player_units_copy(&state->units[i], &old->units[i], capacity, units_of(state), base + state->units_offset[i]);
+    }
+
+    free(old);
+    game->state = state;
+    game->state_capacity = state->bytes;
+    game->state_growths++;
+}
+
+/**
+ * Grows the state, if needed, so that extra more units fit in it. Done at the end of every turn
+ * for all units of the next player, as each of them can produce at most one unit in a turn.
+ */
+static void reserve_units(board *game, unsigned int extra) {
+    unsigned int needed = unit_pool_in_use(&game->state->pool) + extra;
+    if (needed > game->state->capacity) {
+        grow_state(game, MAX(needed, 2 * game->state->capacity));
+    }
+}
+
+/**
+ * Marks the game as initialized, with nothing recorded.
+ */
+static void start_match(board *game) {
+    game->initialized = true;
+    game->state_growths = 0;
+    game->undo_log = malloc(INITIAL_UNDO_CAPACITY * sizeof(undo_record));
+    game->undo_count = 0;
+    game->undo_capacity = INITIAL_UNDO_CAPACITY;
+    game->recording = NULL;
+}
+
+static void setup_board(board *game, int n, int k, int p) {
+    game_state layout;
+    int i;
+
+    lay_out(&layout, n, INITIAL_UNIT_CAPACITY);
+    game->state = malloc(layout.bytes);
+    game->state_capacity = layout.bytes;
+    *game->state = layout;
+
+    game_state *state = game->state;
+    char *base = (char *) state;
+    unit_pool_init(&state->pool, units_of(state), state->capacity);
+    unit_index_init(&state->index, n, state->capacity, base + state->index_offset);
+    for (i = 0; i < 2; i++) {
+        player_units_init(&state->units[i], n, state->capacity, units_of(state), base + state->units_offset[i]);
+        state->heads[i] = NO_UNIT;
+    }
+    state->size = n;
+    state->number_of_rounds_left = k;
+    state->this_player = p;
+    state->turn = 1;
+    state->built_peasant = false;
+    state->ai_epoch = 0;
+    state->next_unit_id = 1;
+    state->hash = rounds_key(k);
+    start_match(game);
+}
+
+#ifdef ENGINE_CROSS_CHECK
+/**
+ * Finds unit on (x1, y1) walking the whole list. Kept as a reference for the index.
+ */
+static unit* find_unit_in_list(board *game, int x1, int y1) {
+    int i;
+    for (i = 0; i < 2; i++) {
+        unit *unit_iterator = unit_number(game, game->state->heads[i]);
+        while (unit_iterator != NULL) {
+            if (unit_iterator->x == x1 && unit_iterator->y == y1) {
+                return unit_iterator;
+            }
+
+            unit_iterator = unit_number(game, unit_iterator->next);
+        }
     }
 
     return NULL;
 }
+#endif
+
+static unit* find_unit(board *game, int x1, int y1) {
+    unit *found = unit_number(game, unit_index_find(&game->state->index, x1, y1));
+
+#ifdef ENGINE_CROSS_CHECK
+    assert(found == find_unit_in_list(game, x1, y1));
+#endif
+
+    return found;
+}
 
 /**
- * Inserts new unit to the beginning of the list.
+ * Inserts new unit to the beginning of the list of its player.
  */
-static int insert_unit(char unit_type, int x, int y) {
-    if (MAX(x, y) > game->size || MIN(x, y) < 1) {
-        return wrong_command_exit(); // error, position (x,y) is out of a board
-    } else if (find_unit( x, y ) != NULL) {
-        return wrong_command_exit(); // error, position (x,y) is occupied
+static int insert_unit(board *game, char unit_type, int x, int y) {
+    if (MAX(x, y) > game->state->size || MIN(x, y) < 1) {
+        return RESULT_WRONG_COMMAND; // error, position (x,y) is out of a board
+    } else if (find_unit(game, x, y) != NULL) {
+        return RESULT_WRONG_COMMAND; // error, position (x,y) is occupied
     }
 
-    unit *new_unit = malloc(sizeof(unit));
+    unit *new_unit = unit_pool_acquire(&game->state->pool);
+    if (new_unit == NULL) { // not reached in a turn, see `reserve_units`; moves all units
+        reserve_units(game, 1);
+        new_unit = unit_pool_acquire(&game->state->pool);
+    }
     new_unit->type = unit_type;
     new_unit->x = x;
     new_unit->y = y;
-    new_unit->empty_rounds = 0;
-    new_unit->ai_move = 0;
-    new_unit->next = game->head;
-    game->head = new_unit;
+    new_unit->idle_since = game->state->number_of_rounds_left;
+    new_unit->ai_epoch = 0;
+    new_unit->id = game->state->next_unit_id++;
+
+    int number = number_of(game, new_unit);
+    int *head = &game->state->heads[player(new_unit) - 1];
+    new_unit->prev = NO_UNIT;
+    new_unit->next = *head;
+    if (*head != NO_UNIT) {
+        unit_number(game, *head)->prev = number;
+    }
+    *head = number;
+    player_units_add(&game->state->units[player(new_unit) - 1], new_unit);
+    unit_index_insert(&game->state->index, x, y, number);
+    toggle_unit(game, new_unit);
 
     return 0;
 }
 
+/**
+ * Number of full rounds unit u has been idle for. -1 means a move done in a current round;
+ * when =2 then peasant can produce new unit.
+ */
+static int empty_rounds(board *game, unit* u) {
+    return u->idle_since - game->state->number_of_rounds_left;
+}
+
+/**
+ * Marks that unit u has acted in a current round.
+ */
+static void mark_acted(board *game, unit* u) {
+    u->idle_since = game->state->number_of_rounds_left - 1;
+    player_units_update(&game->state->units[player(u) - 1], u);
+}
+
 /**
  * Distance in an infinity norm between (x1,y1) and (x2,y2).
  */
@@ -138,90 +478,122 @@ static int player(unit* u) {
     }
 }
 
-/**
- * Locates closest enemy unit.
- */
-static unit* find_closest_enemy_unit(int x1, int y1) {
-    unit *unit_iterator = game->head;
-    unit *closest_enemy;
-    int dist = 0;
-    int min_dist = INT_MAX;
-    while (unit_iterator != NULL) {
-        if (player(unit_iterator) != game->this_player) {
-            dist = distance(x1, y1, unit_iterator->x, unit_iterator->y);
-            if ( dist < min_dist) {
-                min_dist = dist;
-                closest_enemy = unit_iterator;
-            }
-        }
-         unit_iterator = unit_iterator->next;
+int game_turn(board *game) {
+    return game->state->turn;
+}
+
+int game_player(board *game) {
+    return game->state->this_player;
+}
+
+int game_size(board *game) {
+    return game->state->size;
+}
+
+unit* game_units(board *game, int p) {
+    return unit_number(game, game->state->heads[p - 1]);
+}
+
+unit* game_next_unit(board *game, unit *u) {
+    return unit_number(game, u->next);
+}
+
+unit* game_unit_at(board *game, int x, int y) {
+    if (MAX(x, y) > game->state->size || MIN(x, y) < 1) {
+        return NULL;
     }
-    return closest_enemy;
+    return find_unit(game, x, y);
+}
+
+uint64_t game_hash(board *game) {
+    return game->state->hash;
+}
+
+int game_idle_rounds(board *game, unit *u) {
+    return empty_rounds(game, u);
+}
+
+unit* game_closest_unit(board *game, int p, int x, int y) {
+    return player_units_closest(&game->state->units[p - 1], x, y);
 }
 
 /**
- * Finds and returns next unit that wasn't considered by AI this turn.
+ * Locates closest enemy unit.
  */
-static unit* find_next_free_unit() {
-    unit *unit_iterator = game->head;
-    while (unit_iterator != NULL) {
-        if (unit_iterator->ai_move == 0 && player(unit_iterator) == game->this_player) {
-            return unit_iterator;
-        }
-        unit_iterator = unit_iterator->next;
-    }
-    return NULL;
+static unit* find_closest_enemy_unit(board *game, int x1, int y1) {
+    return player_units_closest(&game->state->units[2 - game->state->this_player], x1, y1);
 }
 
 /**
- * Clears AI choices for this turn.
+ * Finds and returns next unit of this AI, starting from its unit u, that wasn't considered by AI this turn.
  */
-void clear_ai_move() {
-    unit *unit_iterator = game->head;
-    while (unit_iterator != NULL) {
-        unit_iterator->ai_move = 0;
-        unit_iterator = unit_iterator->next;
+static unit* find_next_free_unit(board *game, unit *u) {
+    while (u != NULL && u->ai_epoch == game->state->ai_epoch) {
+        u = unit_number(game, u->next);
     }
+    return u;
 }
 
  /**
- * Deleting unit u from the list of units.
+ * Deleting unit u from the list of units. While an action is recorded the memory of u
+ * is kept, together with its links to neighbours, so that `resurrect` can put it back.
  */
-static void kill(unit* u) {
-    unit *unit_iterator = game->head;
+static void kill(board *game, unit* u) {
+    int number = number_of(game, u);
 
-    if (unit_iterator->x == u->x &&
-        unit_iterator->y == u->y &&
-        unit_iterator->type == u->type) {
+    toggle_unit(game, u);
+    if (unit_index_find(&game->state->index, u->x, u->y) == number) {
+        unit_index_remove(&game->state->index, u->x, u->y);
+    }
 
-        game->head = (game->head)->next;
-        free(u);
-        u = NULL;
+    if (u->prev == NO_UNIT) {
+        game->state->heads[player(u) - 1] = u->next;
     } else {
-        while ((unit_iterator->next)->x != u->x ||
-               (unit_iterator->next)->y != u->y ||
-               (unit_iterator->next)->type != u->type) {
-            unit_iterator = unit_iterator->next;
-        }
+        unit_number(game, u->prev)->next = u->next;
+    }
+    if (u->next != NO_UNIT) {
+        unit_number(game, u->next)->prev = u->prev;
+    }
+    player_units_remove(&game->state->units[player(u) - 1], u);
+
+    if (game->recording != NULL) {
+        game->recording->killed[game->recording->killed_count++] = number;
+    } else {
+        unit_pool_release(&game->state->pool, u);
+    }
+}
+
+/**
+ * Reverts `kill` of unit u. Units killed later have to be resurrected first.
+ * Does not touch the index.
+ */
+static void resurrect(board *game, unit* u) {
+    int number = number_of(game, u);
 
-        unit_iterator->next = (unit_iterator->next)->next;
-        free(u);
-        u = NULL;
+    if (u->prev == NO_UNIT) {
+        game->state->heads[player(u) - 1] = number;
+    } else {
+        unit_number(game, u->prev)->next = number;
     }
+    if (u->next != NO_UNIT) {
+        unit_number(game, u->next)->prev = number;
+    }
+    player_units_restore(&game->state->units[player(u) - 1], u);
 }
 
 /**
- * Fight between unit1 and unit2.
+ * Fight between unit1 and unit2. unit1 has already moved onto the field of unit2,
+ * which is indexed to unit2 until the winner is known.
  * @return the same kind of output as `move`.
  */
-static int fight(unit* unit1, unit* unit2) {
+static int fight(board *game, unit* unit1, unit* unit2) {
     // change uppercase letters into lowercase
     char simple_type1 = unit1->type + 32 * (unit1->type <= 90);
     char simple_type2 = unit2->type + 32 * (unit2->type <= 90);
 
     if (simple_type1 == simple_type2) {
-        kill(unit1);
-        kill(unit2);
+        kill(game, unit1);
+        kill(game, unit2);
 
         if (simple_type1 == 'k') {		// both kings die
             return RESULT_DRAW;
@@ -229,145 +601,152 @@ static int fight(unit* unit1, unit* unit2) {
             return RESULT_ONGOING;
         }
     } else if (simple_type1 == 'c') {
-        kill(unit1);
+        kill(game, unit1);
 
         return RESULT_ONGOING;
     } else if (simple_type2 == 'c') {
-        kill(unit2);
+        kill(game, unit2);
+        unit_index_insert(&game->state->index, unit1->x, unit1->y, number_of(game, unit1));
 
         return RESULT_ONGOING;
     } else if (simple_type1 == 'r' && simple_type2 == 'k') {
         int result;
 
         if (unit2->type == 'k') {
-            result = game->this_player == 1 ? RESULT_WIN : RESULT_LOSE;
+            result = game->state->this_player == 1 ? RESULT_WIN : RESULT_LOSE;
         } else {
             assert(unit2->type == 'K');
-            result = game->this_player == 2 ? RESULT_WIN : RESULT_LOSE;
+            result = game->state->this_player == 2 ? RESULT_WIN : RESULT_LOSE;
         }
 
-        kill(unit2);
+        kill(game, unit2);
+        unit_index_insert(&game->state->index, unit1->x, unit1->y, number_of(game, unit1));
 
         return result;
     } else if (simple_type1 == 'k' && simple_type2 == 'r') {
         int result;
 
         if (unit1->type == 'k') {
-            result = game->this_player == 1 ? RESULT_WIN : RESULT_LOSE;
+            result = game->state->this_player == 1 ? RESULT_WIN : RESULT_LOSE;
         } else {
             assert(unit1->type == 'K');
-            result = game->this_player == 2 ? RESULT_WIN : RESULT_LOSE;
+            result = game->state->this_player == 2 ? RESULT_WIN : RESULT_LOSE;
         }
 
-        kill(unit1);
+        kill(game, unit1);
 
         return result;
     }
 }
 
-static void increase_empty_rounds() {
-    unit *unit_iterator = game->head;
-    while (unit_iterator != NULL) {
-        (unit_iterator->empty_rounds)++;
-        unit_iterator = unit_iterator->next;
-    }
-}
-
 /**
  * Returns `RESULT_WRONG_COMMAND` in a case of error.
  * Returns `RESULT_ONGOING` otherwise.
  */
-int init(int n, int k, int player, int x1, int y1, int x2, int y2) {
+int game_init(board *game, int n, int k, int player, int x1, int y1, int x2, int y2) {
     if (player < 1  ||
         player > 2  ||
              n <= 8 ||
              k < 1) {
-        return wrong_command_exit(); // error, wrong player number, too small board size or non-positive number of rounds
+        return wrong_command_exit(game); // error, wrong player number, too small board size or non-positive number of rounds
     }
 
     if (x1 < 1 || y1 < 1 || x2 < 1 || y2 < 1 ||
         x1 > n || y1 > n || x2 > n || y2 > n) {
-        return wrong_command_exit(); // error, (x1,y1) or (x2,y2) out of board
+        return wrong_command_exit(game); // error, (x1,y1) or (x2,y2) out of board
     }
 
     if (MAX(x1, x2) > n-3 || distance(x1, y1, x2, y2) < 8) {
-        return wrong_command_exit(); // error, the units are out of a board or distance between kings is too small
+        return wrong_command_exit(game); // error, the units are out of a board or distance between kings is too small
     }
 
-    if (game == NULL) {
+    if (game_is_not_initialized(game)) {
         int execution_code = 0; // check if any insert_unit failed
 
-        game = new_board(n, k, player);
-        execution_code += insert_unit('K', x1  , y1);
-        execution_code += insert_unit('C', x1+1, y1);
-        execution_code += insert_unit('R', x1+2, y1);
-        execution_code += insert_unit('R', x1+3, y1);
-        execution_code += insert_unit('k', x2  , y2);
-        execution_code += insert_unit('c', x2+1, y2);
-        execution_code += insert_unit('r', x2+2, y2);
-        execution_code += insert_unit('r', x2+3, y2);
+        setup_board(game, n, k, player);
+        execution_code += insert_unit(game, 'K', x1  , y1);
+        execution_code += insert_unit(game, 'C', x1+1, y1);
+        execution_code += insert_unit(game, 'R', x1+2, y1);
+        execution_code += insert_unit(game, 'R', x1+3, y1);
+        execution_code += insert_unit(game, 'k', x2  , y2);
+        execution_code += insert_unit(game, 'c', x2+1, y2);
+        execution_code += insert_unit(game, 'r', x2+2, y2);
+        execution_code += insert_unit(game, 'r', x2+3, y2);
 
         if (execution_code != 0) {
-            return wrong_command_exit(); // error, some insert_unit failed
+            return wrong_command_exit(game); // error, some insert_unit failed
         } else {
             return RESULT_ONGOING;
         }
     } else {
-        return wrong_command_exit(); // error, we got two INITs
+        return wrong_command_exit(game); // error, we got two INITs
     }
 }
 
-int ai_turn() {
-    return game_is_not_initialized() || game->turn != game->this_player ? 0 : 1;
+int game_ai_turn(board *game) {
+    return game_is_not_initialized(game) || game->state->turn != game->state->this_player ? 0 : 1;
 }
 
 /**
  * Makes the move and returns state of the game afterwards.
+ * An incorrect move returns `RESULT_WRONG_COMMAND` and leaves the game untouched.
  */
-int move(int x1, int y1, int x2, int y2) {
-    if (game_is_not_initialized()) {
-        return wrong_command_exit(); // error, move before INIT
+static int apply_move(board *game, int x1, int y1, int x2, int y2) {
+    if (game_is_not_initialized(game)) {
+        return RESULT_WRONG_COMMAND; // error, move before INIT
     } else if (distance( x1, y1, x2, y2 ) > 1) {
-        return wrong_command_exit(); // error, move to non-adjacent position
-    } else if (MAX(MAX(x1, y1), MAX(x2, y2)) > game->size ||
+        return RESULT_WRONG_COMMAND; // error, move to non-adjacent position
+    } else if (MAX(MAX(x1, y1), MAX(x2, y2)) > game->state->size ||
         MIN(MIN(x1, y1), MIN(x2, y2)) < 1) {
-        return wrong_command_exit(); // error, move out of a board
+        return RESULT_WRONG_COMMAND; // error, move out of a board
     }
 
-    unit* moved_unit = find_unit(x1, y1);
+    unit* moved_unit = find_unit(game, x1, y1);
     if (moved_unit == NULL) {
-        return wrong_command_exit(); // error, lack of unit at (x1,x2)
+        return RESULT_WRONG_COMMAND; // error, lack of unit at (x1,x2)
     }
 
-    if (moved_unit->empty_rounds == -1) {
-        return wrong_command_exit(); // error, this unit was already moved
+    if (empty_rounds(game, moved_unit) == -1) {
+        return RESULT_WRONG_COMMAND; // error, this unit was already moved
     }
-    if (player(moved_unit) != game->turn) {
-        return wrong_command_exit(); // error, unit does not belong to the current player
+    if (player(moved_unit) != game->state->turn) {
+        return RESULT_WRONG_COMMAND; // error, unit does not belong to the current player
     }
 
-    unit* destination_unit = find_unit(x2, y2);
+    unit* destination_unit = find_unit(game, x2, y2);
 
     // only change a position of an unit
     if (destination_unit == NULL) {
+        unit_index_remove(&game->state->index, x1, y1);
+        unit_index_insert(&game->state->index, x2, y2, number_of(game, moved_unit));
+        toggle_unit(game, moved_unit);
         moved_unit->x = x2;
         moved_unit->y = y2;
-        moved_unit->empty_rounds = -1;
+        mark_acted(game, moved_unit);
+        toggle_unit(game, moved_unit);
 
         return RESULT_ONGOING;
     } else {
         if (player(moved_unit) == player(destination_unit)) {
-            return wrong_command_exit(); // error, try to movef into position occupied by his own unit
+            return RESULT_WRONG_COMMAND; // error, try to movef into position occupied by his own unit
         }
         else {
+            // the field stays indexed to the defender, fight gives it to the mover if it wins
+            unit_index_remove(&game->state->index, x1, y1);
+            toggle_unit(game, moved_unit);
             moved_unit->x = x2;
             moved_unit->y = y2;
-            moved_unit->empty_rounds = -1;
-            return fight(moved_unit, destination_unit);
+            mark_acted(game, moved_unit);
+            toggle_unit(game, moved_unit);
+            return fight(game, moved_unit, destination_unit);
         }
     }
 }
 
+int game_move(board *game, int x1, int y1, int x2, int y2) {
+    return checked(game, apply_move(game, x1, y1, x2, y2));
+}
+
 static int is_not_peasant(unit *pawn) {
     if (pawn->type != 'c' && pawn->type != 'C') {
         return 1;
@@ -377,36 +756,42 @@ static int is_not_peasant(unit *pawn) {
 }
 
 /**
- * Real implementation of `produce_*` functions. Returns the same what they do.
+ * Real implementation of `produce_*` functions. Returns the same what they do,
+ * but an incorrect production leaves the game untouched.
  */
-static int produce_unit(int x1, int y1, int x2, int y2, char type) {
-    if (game_is_not_initialized()) {
-        return wrong_command_exit(); // error, action before INIT
+static int produce_unit(board *game, int x1, int y1, int x2, int y2, char type) {
+    if (game_is_not_initialized(game)) {
+        return RESULT_WRONG_COMMAND; // error, action before INIT
     } else if (distance( x1, y1, x2, y2 ) > 1) {
-        return wrong_command_exit(); // error, action at non-adjacent position
-    } else if (MAX(MAX(x1, y1), MAX(x2, y2)) > game->size ||
+        return RESULT_WRONG_COMMAND; // error, action at non-adjacent position
+    } else if (MAX(MAX(x1, y1), MAX(x2, y2)) > game->state->size ||
         MIN(MIN(x1, y1), MIN(x2, y2)) < 1) {
-        return wrong_command_exit(); // error, move out of a board
+        return RESULT_WRONG_COMMAND; // error, move out of a board
     }
 
-    unit* peasant_produces = find_unit(x1, y1);
+    unit* peasant_produces = find_unit(game, x1, y1);
     if (peasant_produces == NULL) {
-        return wrong_command_exit(); // error, lack of unit at (x1,x2)
-    } else if (player(peasant_produces) != game->turn ||
+        return RESULT_WRONG_COMMAND; // error, lack of unit at (x1,x2)
+    } else if (player(peasant_produces) != game->state->turn ||
         is_not_peasant(peasant_produces)) {
-        return wrong_command_exit(); // error, an unit does not belong to the current player or it is not a peasant
-    } else if (peasant_produces->empty_rounds < 2) {
-        return wrong_command_exit(); // error, a peasant did not wait at least 2 rounds
+        return RESULT_WRONG_COMMAND; // error, an unit does not belong to the current player or it is not a peasant
+    } else if (empty_rounds(game, peasant_produces) < 2) {
+        return RESULT_WRONG_COMMAND; // error, a peasant did not wait at least 2 rounds
     }
 
-    unit* new_unit_destination = find_unit(x2, y2);
+    unit* new_unit_destination = find_unit(game, x2, y2);
     if (new_unit_destination != NULL) {
-        return wrong_command_exit(); // error, try to move into position occupied by his own unit
-    } else if ( insert_unit(type, x2, y2) != 0 ) {
-        return wrong_command_exit(); // error during inserting unit
+        return RESULT_WRONG_COMMAND; // error, try to move into position occupied by his own unit
     }
 
-    peasant_produces->empty_rounds = -1;
+    // before inserting, which could move units if the state had to grow
+    toggle_unit(game, peasant_produces);
+    mark_acted(game, peasant_produces);
+    toggle_unit(game, peasant_produces);
+
+    if ( insert_unit(game, type, x2, y2) != 0 ) {
+        return RESULT_WRONG_COMMAND; // error during inserting unit
+    }
 
     return RESULT_ONGOING;
 }
@@ -417,7 +802,7 @@ static int produce_unit(int x1, int y1, int x2, int y2, char type) {
  * is a knight or a peasant (knights want to kill enemy units, peasants don't want to/can't produce on
  * tiles occupied by enemy).
  */
-int check_if_move_legal(int x1, int y1, enum MoveDirection direction, bool peasant) {
+int check_if_move_legal(board *game, int x1, int y1, enum MoveDirection direction, bool peasant) {
     int x2 = x1;
     int y2 = y1;
     switch (direction) {
@@ -454,42 +839,42 @@ int check_if_move_legal(int x1, int y1, enum MoveDirection direction, bool peasa
         default :
             assert(false);
     }
-    unit* new_unit_destination = find_unit(x2, y2); // checks for other units
+    if (MAX(x2, y2) > game->state->size ||                 // checks for board borders
+        MIN(x2, y2) < 1) {
+        return 0;
+    }
+    unit* new_unit_destination = find_unit(game, x2, y2); // checks for other units
     if (new_unit_destination != NULL &&
-        player(new_unit_destination) == game->this_player) {
+        player(new_unit_destination) == game->state->this_player) {
         return 0;                                   // allied unit
     }
     if (new_unit_destination != NULL &&
         peasant == true) {
         return 0;                                   // enemy unit on tile where peasant is trying to build
     }
-    if (MAX(x2, y2) > game->size ||                 // checks for board borders
-        MIN(x2, y2) < 1) {
-        return 0;
-    }
     return 1;
 }
 
 /**
  * Produces a knight and returns state of the game.
  */
-int produce_knight(int x1, int y1, int x2, int y2) {
-    if (game_is_not_initialized()) {
-        return wrong_command_exit(); // error, move before INIT
+int game_produce_knight(board *game, int x1, int y1, int x2, int y2) {
+    if (game_is_not_initialized(game)) {
+        return wrong_command_exit(game); // error, move before INIT
     }
 
-    return produce_unit(x1, y1, x2, y2, game->turn == 1 ? 'R' : 'r'); // inserts r or R (if player is 2 or 1 respectively)
+    return checked(game, produce_unit(game, x1, y1, x2, y2, game->state->turn == 1 ? 'R' : 'r')); // inserts r or R (if player is 2 or 1 respectively)
 }
 
 /**
  * Produces a peasant and returns state of the game.
  */
-int produce_peasant(int x1, int y1, int x2, int y2) {
-    if (game_is_not_initialized()) {
-        return wrong_command_exit(); // error, move before INIT
+int game_produce_peasant(board *game, int x1, int y1, int x2, int y2) {
+    if (game_is_not_initialized(game)) {
+        return wrong_command_exit(game); // error, move before INIT
     }
 
-    return produce_unit(x1, y1, x2, y2, game->turn == 1 ? 'C' : 'c'); // inserts c or C (if player is 2 or 1 respectively)
+    return checked(game, produce_unit(game, x1, y1, x2, y2, game->state->turn == 1 ? 'C' : 'c')); // inserts c or C (if player is 2 or 1 respectively)
 }
 
 /**
@@ -497,36 +882,266 @@ int produce_peasant(int x1, int y1, int x2, int y2) {
  * Returns 42 when game was not initialized.
  * Returns 0 otherwise.
  */
-int end_turn() {
-    if (game_is_not_initialized()) {
-        return wrong_command_exit(); // error, move before INIT
+int game_end_turn(board *game) {
+    if (game_is_not_initialized(game)) {
+        return wrong_command_exit(game); // error, move before INIT
     }
 
-    if (game->turn == 1) {
-        game->turn = 2;
+    game->state->hash ^= SIDE_KEY;
+    if (game->state->turn == 1) {
+        game->state->turn = 2;
     } else {
-        --(game->number_of_rounds_left);
+        game->state->hash ^= rounds_key(game->state->number_of_rounds_left) ^ rounds_key(game->state->number_of_rounds_left - 1);
+        --(game->state->number_of_rounds_left);
 
-        if (game->number_of_rounds_left == 0) { // it was the last one round
+        if (game->state->number_of_rounds_left == 0) { // it was the last one round
             return RESULT_DRAW;
         }
 
-        game->turn = 1;
-        increase_empty_rounds(); // updates empty rounds for each unit and prepares units for new turn
+        game->state->turn = 1; // empty rounds of all units grow by themselves, as they are counted from number_of_rounds_left
     }
+    reserve_units(game, game->state->units[game->state->turn - 1].count);
+
+#ifdef ENGINE_CROSS_CHECK
+    assert(game->state->hash == hash_from_scratch(game));
+#endif
 
     return RESULT_ONGOING;
 }
 
+/**
+ * Checks if (x, y) lies on the board.
+ */
+static bool on_board(board *game, int x, int y) {
+    return MAX(x, y) <= game->state->size && MIN(x, y) >= 1;
+}
+
+/**
+ * Appends a new record to the undo log.
+ */
+static undo_record* push_record(board *game, enum UndoKind kind) {
+    if (game->undo_count == game->undo_capacity) {
+        game->undo_capacity *= 2;
+        game->undo_log = realloc(game->undo_log, game->undo_capacity * sizeof(undo_record));
+    }
+
+    undo_record *record = &game->undo_log[game->undo_count++];
+    record->kind = kind;
+    record->mover = NO_UNIT;
+    record->destination = NO_UNIT;
+    record->produced = NO_UNIT;
+    record->killed_count = 0;
+    record->turn = game->state->turn;
+    record->number_of_rounds_left = game->state->number_of_rounds_left;
+    record->hash = game->state->hash;
+    return record;
+}
+
+/**
+ * Fills the record with units standing on (x1, y1) and (x2, y2).
+ */
+static void record_fields(board *game, undo_record *record, int x1, int y1, int x2, int y2) {
+    record->x1 = x1;
+    record->y1 = y1;
+    record->x2 = x2;
+    record->y2 = y2;
+    if (on_board(game, x1, y1) && on_board(game, x2, y2)) {
+        record->mover = number_of(game, find_unit(game, x1, y1));
+        record->destination = number_of(game, find_unit(game, x2, y2));
+    }
+    if (record->mover != NO_UNIT) {
+        unit *mover = unit_number(game, record->mover);
+        record->idle_since = mover->idle_since;
+        record->cell_prev = mover->cell_prev;
+        record->cell_next = mover->cell_next;
+    }
+}
+
+/**
+ * Ends recording of an action. The record of an incorrect one is dropped.
+ */
+static int finish_record(board *game, int result) {
+    game->recording = NULL;
+    if (result == RESULT_WRONG_COMMAND) {
+        game->undo_count--;
+    }
+
+    return result;
+}
+
+int game_make_move(board *game, int x1, int y1, int x2, int y2) {
+    if (game_is_not_initialized(game)) {
+        return RESULT_WRONG_COMMAND;
+    }
+
+    undo_record *record = push_record(game, UNDO_MOVE);
+    record_fields(game, record, x1, y1, x2, y2);
+    game->recording = record;
+    return finish_record(game, apply_move(game, x1, y1, x2, y2));
+}
+
+/**
+ * Recorded version of `produce_unit`.
+ */
+static int make_produce(board *game, int x1, int y1, int x2, int y2, char type) {
+    undo_record *record = push_record(game, UNDO_PRODUCE);
+    record_fields(game, record, x1, y1, x2, y2);
+    int result = produce_unit(game, x1, y1, x2, y2, type);
+    if (result != RESULT_WRONG_COMMAND) {
+        record->produced = number_of(game, find_unit(game, x2, y2));
+    }
+
+    return finish_record(game, result);
+}
+
+int game_make_produce_knight(board *game, int x1, int y1, int x2, int y2) {
+    if (game_is_not_initialized(game)) {
+        return RESULT_WRONG_COMMAND;
+    }
+
+    return make_produce(game, x1, y1, x2, y2, game->state->turn == 1 ? 'R' : 'r');
+}
+
+int game_make_produce_peasant(board *game, int x1, int y1, int x2, int y2) {
+    if (game_is_not_initialized(game)) {
+        return RESULT_WRONG_COMMAND;
+    }
+
+    return make_produce(game, x1, y1, x2, y2, game->state->turn == 1 ? 'C' : 'c');
+}
+
+int game_make_end_turn(board *game) {
+    if (game_is_not_initialized(game)) {
+        return RESULT_WRONG_COMMAND;
+    }
+
+    push_record(game, UNDO_END_TURN);
+    return game_end_turn(game);
+}
+
+int game_unmake(board *game) {
+    if (game_is_not_initialized(game) || game->undo_count == 0) {
+        return RESULT_WRONG_COMMAND;
+    }
+
+    undo_record *record = &game->undo_log[--game->undo_count];
+    unit *mover = unit_number(game, record->mover);
+    int i;
+
+    switch (record->kind) {
+        case UNDO_MOVE :
+            unit_index_remove(&game->state->index, record->x2, record->y2);
+            for (i = record->killed_count - 1; i >= 0; i--) {
+                resurrect(game, unit_number(game, record->killed[i]));
+            }
+            mover->x = record->x1;
+            mover->y = record->y1;
+            mover->idle_since = record->idle_since;
+            player_units_revert_update(&game->state->units[player(mover) - 1], mover,
+                                       record->cell_prev, record->cell_next);
+            unit_index_insert(&game->state->index, record->x1, record->y1, record->mover);
+            if (record->destination != NO_UNIT) {
+                unit_index_insert(&game->state->index, record->x2, record->y2, record->destination);
+            }
+            break;
+        case UNDO_PRODUCE :
+            kill(game, unit_number(game, record->produced));
+            game->state->next_unit_id--;
+            mover->idle_since = record->idle_since;
+            player_units_update(&game->state->units[player(mover) - 1], mover);
+            break;
+        case UNDO_END_TURN :
+            break;
+    }
+
+    // idle_since of units is counted from number_of_rounds_left, so it needs no restoring here
+    game->state->turn = record->turn;
+    game->state->number_of_rounds_left = record->number_of_rounds_left;
+    game->state->hash = record->hash;
+
+#ifdef ENGINE_CROSS_CHECK
+    assert(game->state->hash == hash_from_scratch(game));
+#endif
+
+    return 0;
+}
+
+void game_clear_undo(board *game) {
+    size_t i;
+    int j;
+
+    if (game_is_not_initialized(game)) {
+        return;
+    }
+
+    for (i = 0; i < game->undo_count; i++) {
+        for (j = 0; j < game->undo_log[i].killed_count; j++) {
+            unit_pool_release(&game->state->pool, unit_number(game, game->undo_log[i].killed[j]));
+        }
+    }
+    game->undo_count = 0;
+}
+
+/**
+ * Makes the state of game a copy of state, growing its buffer if needed. Forgets recorded actions.
+ */
+static void load_state(board *game, const game_state *state) {
+    if (game_is_not_initialized(game)) {
+        start_match(game);
+    } else {
+        game_clear_undo(game);
+    }
+
+    if (game->state_capacity < state->bytes) {
+        free(game->state);
+        game->state = malloc(state->bytes);
+        game->state_capacity = state->bytes;
+    }
+    memcpy(game->state, state, state->bytes);
+    bind_state(game->state);
+}
+
+void game_copy(board *dst, board *src) {
+    size_t i;
+    int j;
+
+    load_state(dst, src->state);
+    for (i = 0; i < src->undo_count; i++) { // kept by src for its undo log, which is not copied
+        for (j = 0; j < src->undo_log[i].killed_count; j++) {
+            unit_pool_release(&dst->state->pool, unit_number(dst, src->undo_log[i].killed[j]));
+        }
+    }
+}
+
+void game_snapshot(board *game, snapshot *snap) {
+    if (snap->capacity < game->state->bytes) {
+        snap->capacity = game->state->bytes;
+        snap->data = realloc(snap->data, snap->capacity);
+    }
+    snap->bytes = game->state->bytes;
+    memcpy(snap->data, game->state, snap->bytes);
+}
+
+void game_restore(board *game, const snapshot *snap) {
+    load_state(game, snap->data);
+}
+
+void snapshot_free(snapshot *snap) {
+    free(snap->data);
+    snap->data = NULL;
+    snap->bytes = 0;
+    snap->capacity = 0;
+}
+
 /**
  * Checks if the desired move is possible, if not, suggests 2 alternatives
  */
-enum MoveDirection correct_best_move_towards(int x, int y, enum MoveDirection direction, bool peasant) {
-    if (check_if_move_legal(x, y, direction, peasant)) {
+enum MoveDirection correct_best_move_towards(board *game, int x, int y, enum MoveDirection direction, bool peasant) {
+    if (check_if_move_legal(game, x, y, direction, peasant)) {
         return direction;
-    } else if (check_if_move_legal(x, y, (direction+1) % 8, peasant)) { // clockwise
+    } else if (check_if_move_legal(game, x, y, (direction+1) % 8, peasant)) { // clockwise
         return (direction + 1) % 8;
-    } else if (check_if_move_legal(x, y, (direction-1) % 8, peasant)) { // counterclockwise
+    } else if (check_if_move_legal(game, x, y, (direction-1) % 8, peasant)) { // counterclockwise
         return (direction-1) % 8;
     } else {
         return STAY;
@@ -536,7 +1151,7 @@ enum MoveDirection correct_best_move_towards(int x, int y, enum MoveDirection di
 /**
  * Determines in which direction unit should move, assuming no obstacles
  */
-enum MoveDirection find_best_move_towards(unit* ally, unit* enemy, bool peasant) {
+enum MoveDirection find_best_move_towards(board *game, unit* ally, unit* enemy, bool peasant) {
     enum MoveDirection direction;
     if (ally == NULL || enemy == NULL) {
         return WRONG_INPUT;
@@ -568,28 +1183,30 @@ enum MoveDirection find_best_move_towards(unit* ally, unit* enemy, bool peasant)
             direction = SE;
         }
     }
-    return correct_best_move_towards(ally->x, ally->y, direction, peasant);
+    return correct_best_move_towards(game, ally->x, ally->y, direction, peasant);
 }
 
 /**
  * AI king doesn't move
  */
-int move_king_ai(unit* king) {
-    king->ai_move = 1;
+int move_king_ai(board *game, unit* king) {
+    king->ai_epoch = game->state->ai_epoch;
     return RESULT_ONGOING;
 }
 
+int move_unit_ai(board *game, unit* pawn);
+
 /**
  * AI peasant builds another peasant, then spawns knights towards closest enemy unit.
  */
-int move_peasant_ai(unit* peasant) {
-    peasant->ai_move = 1;
+int move_peasant_ai(board *game, unit* peasant) {
+    peasant->ai_epoch = game->state->ai_epoch;
     int x = peasant->x;
     int y = peasant->y;
 
-    if (peasant->empty_rounds == 2) {
-        unit* enemy = find_closest_enemy_unit(x, y);
-        enum MoveDirection direction = find_best_move_towards(peasant, enemy, true);
+    if (empty_rounds(game, peasant) == 2) {
+        unit* enemy = find_closest_enemy_unit(game, x, y);
+        enum MoveDirection direction = find_best_move_towards(game, peasant, enemy, true);
         switch (direction) {
             case NW :
                 x--;
@@ -626,14 +1243,19 @@ int move_peasant_ai(unit* peasant) {
             default :
                 assert(false);
         }
-        if (game->built_peasant == false) {
-            game->built_peasant = true;
-            print_produce_peasant_command(peasant->x, peasant->y, x, y);
-            return produce_peasant(peasant->x, peasant->y,x, y);
+        int exit_code;
+        if (game->state->built_peasant == false) {
+            game->state->built_peasant = true;
+            print_produce_peasant_command(game->out, peasant->x, peasant->y, x, y);
+            exit_code = game_produce_peasant(game, peasant->x, peasant->y,x, y);
         } else {
-            print_produce_knight_command(peasant->x, peasant->y, x, y);
-            return produce_knight(peasant->x, peasant->y, x, y);
+            print_produce_knight_command(game->out, peasant->x, peasant->y, x, y);
+            exit_code = game_produce_knight(game, peasant->x, peasant->y, x, y);
         }
+        if (exit_code == RESULT_ONGOING) {
+            exit_code = move_unit_ai(game, find_unit(game, x, y)); // a new unit moves right after it was produced
+        }
+        return exit_code;
     } else {
         return RESULT_ONGOING;
     }
@@ -642,13 +1264,13 @@ int move_peasant_ai(unit* peasant) {
 /**
  * AI Knights seek closest enemy (updated every turn) and charge.
  */
-int move_knight_ai(unit* knight) {
-    unit* enemy = find_closest_enemy_unit(knight->x, knight->y);
-    enum MoveDirection direction = find_best_move_towards(knight, enemy, false);
+int move_knight_ai(board *game, unit* knight) {
+    unit* enemy = find_closest_enemy_unit(game, knight->x, knight->y);
+    enum MoveDirection direction = find_best_move_towards(game, knight, enemy, false);
     int x = knight->x;
     int y = knight->y;
 
-    knight->ai_move = 1;
+    knight->ai_epoch = game->state->ai_epoch;
     switch (direction) {
         case NW :
             x--;
@@ -685,26 +1307,26 @@ int move_knight_ai(unit* knight) {
         default :
             assert(false);
     }
-    print_move_command(knight->x, knight->y, x, y);
-    return move(knight->x, knight->y, x, y);
+    print_move_command(game->out, knight->x, knight->y, x, y);
+    return game_move(game, knight->x, knight->y, x, y);
 }
 
 /**
  * AI moves units depending on unit type.
  */
-int move_unit_ai(unit* pawn) {
+int move_unit_ai(board *game, unit* pawn) {
     switch(pawn->type){
         case 'c':
         case 'C':
-            return move_peasant_ai(pawn);
+            return move_peasant_ai(game, pawn);
             break;
         case 'k':
         case 'K':
-            return move_king_ai(pawn);
+            return move_king_ai(game, pawn);
             break;
         case 'r':
         case 'R':
-            return move_knight_ai(pawn);
+            return move_knight_ai(game, pawn);
             break;
         default:
             assert(false);
@@ -712,25 +1334,205 @@ int move_unit_ai(unit* pawn) {
 }
 
 /**
- * Have AI compute and print moves for all its units, then end turn.
+ * Prints action a and plays it.
  */
-int ai_make_move() {
+static int play_action(board *game, const action *a) {
+    switch (a->kind) {
+        case ACTION_MOVE :
+            print_move_command(game->out, a->x1, a->y1, a->x2, a->y2);
+            return game_move(game, a->x1, a->y1, a->x2, a->y2);
+        case ACTION_PRODUCE_KNIGHT :
+            print_produce_knight_command(game->out, a->x1, a->y1, a->x2, a->y2);
+            return game_produce_knight(game, a->x1, a->y1, a->x2, a->y2);
+        default :
+            print_produce_peasant_command(game->out, a->x1, a->y1, a->x2, a->y2);
+            return game_produce_peasant(game, a->x1, a->y1, a->x2, a->y2);
+    }
+}
+
+static int greedy_ai_make_move(board *game);
+
+static void* ponder_work(void *arg) {
+    ponder *p = (ponder *) arg;
+    turn_limit limit = {LLONG_MAX, &p->copy->ai_cancelled}; // until the opponent ends its turn
+
+    search_ponder(p->copy, &limit, p->tt);
+    return NULL;
+}
+
+/**
+ * Starts searching the position after the turn of the AI on a copy of the game.
+ */
+static void start_pondering(board *game) {
+    ponder *p = malloc(sizeof(ponder));
+
+    p->copy = game_create();
+    game_copy(p->copy, game);
+    p->tt = &game->tt;
+    if (pthread_create(&p->thread, NULL, ponder_work, p) != 0) {
+        game_destroy(p->copy);
+        free(p);
+        return; // no thread, no pondering
+    }
+    game->ponder = p;
+}
+
+/**
+ * Stops the search started by `start_pondering`, keeping what it has left in the transposition table.
+ */
+static void stop_pondering(board *game) {
+    ponder *p = game->ponder;
+
+    if (p == NULL) {
+        return;
+    }
+    game_cancel_ai(p->copy);
+    pthread_join(p->thread, NULL);
+    game_destroy(p->copy);
+    free(p);
+    game->ponder = NULL;
+}
+
+/**
+ * Search or MCTS AI plays the best turn it finds within its time budget, then ends turn.
+ * When the budget runs out, or the AI is cancelled, before any turn is complete, the greedy AI plays instead.
+ */
+static int search_ai_make_move(board *game) {
+    turn best = {NULL, 0, 0};
+    turn_limit limit = {monotonic_ns() + game->ai.budget_ms * 1000000LL, &game->ai_cancelled};
     int exit_code = RESULT_ONGOING;
-    unit *next_unit;
-    clear_ai_move();
-
-    while (exit_code == RESULT_ONGOING) {
-        next_unit = find_next_free_unit();
-        if (next_unit == NULL) {
-            print_end_turn_command();
-            exit_code = end_turn();
-            assert(exit_code != RESULT_WRONG_COMMAND);
-            return exit_code;
-        } else {
-            exit_code = move_unit_ai(next_unit);
+    bool found = false;
+    size_t i;
+
+    if (limit_reached(&limit) || game->ai.budget_ms <= 0) { // takes a cancel raised before the turn
+        found = false;
+    } else if (game->ai.kind == AI_MCTS) {
+        found = mcts_best_turn(game, &limit, game->ai.workers, &best);
+    } else {
+        if (game->tt.entries == NULL) {
+            tt_init(&game->tt, TT_SIZE_LOG2);
         }
+        found = search_best_turn(game, &limit, &game->tt, &best);
+    }
+    // a cancel which has stopped this turn is cleared, one raised after the search had stopped is left for the next turn
+    int taken = CANCEL_TAKEN;
+    __atomic_compare_exchange_n(&game->ai_cancelled, &taken, CANCEL_NONE, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+
+    if (!found) {
+        return greedy_ai_make_move(game);
+    }
+    for (i = 0; i < best.count && exit_code == RESULT_ONGOING; i++) {
+        exit_code = play_action(game, &best.actions[i]);
+    }
+    turn_free(&best);
+
+    if (exit_code == RESULT_ONGOING) {
+        print_end_turn_command(game->out);
+        exit_code = game_end_turn(game);
     }
     assert(exit_code != RESULT_WRONG_COMMAND);
 
+    if (exit_code == RESULT_ONGOING && game->ai.ponder && game->ai.kind == AI_SEARCH) {
+        start_pondering(game);
+    }
+
+    return exit_code;
+}
+
+/**
+ * Greedy AI moves all its units, then ends turn.
+ */
+static int greedy_ai_make_move(board *game) {
+    int exit_code = RESULT_ONGOING;
+    unit *next_unit;
+    unit *following_unit;
+
+    game->state->ai_epoch++; // forgets choices made in previous turns
+    next_unit = find_next_free_unit(game, game_units(game, game->state->this_player));
+    while (exit_code == RESULT_ONGOING && next_unit != NULL) {
+        // looked up before the move, as the unit may die in it; other units of AI always survive its move
+        following_unit = find_next_free_unit(game, game_next_unit(game, next_unit));
+        exit_code = move_unit_ai(game, next_unit);
+        next_unit = following_unit;
+    }
+
+    if (exit_code == RESULT_ONGOING) {
+        print_end_turn_command(game->out);
+        exit_code = game_end_turn(game);
+    }
+    assert(exit_code != RESULT_WRONG_COMMAND);
+
+    return exit_code;
+}
+
+int game_greedy_turn(board *game) {
+    int player = game->state->this_player;
+    int exit_code;
+
+    game->state->this_player = game->state->turn;
+    exit_code = greedy_ai_make_move(game);
+    if (game->state->this_player != player && (exit_code == RESULT_WIN || exit_code == RESULT_LOSE)) {
+        exit_code = exit_code == RESULT_WIN ? RESULT_LOSE : RESULT_WIN;
+    }
+    game->state->this_player = player;
+
     return exit_code;
+}
+
+/**
+ * Raises the flag polled by the turn limit of the thinking AI.
+ */
+void game_cancel_ai(board *game) {
+    __atomic_store_n(&game->ai_cancelled, CANCEL_RAISED, __ATOMIC_RELAXED);
+}
+
+/**
+ * Have AI compute and print moves for all its units, then end turn.
+ */
+int game_ai_make_move(board *game) {
+    stop_pondering(game);
+    if (game->ai.kind != AI_GREEDY) {
+        return search_ai_make_move(game);
+    }
+
+    return greedy_ai_make_move(game);
 };
+
+static board* global_game; // context used by the functions below
+
+void start_game() {
+    global_game = game_create();
+}
+
+void end_game() {
+    game_destroy(global_game);
+    global_game = NULL;
+}
+
+int init(int n, int k, int p, int x1, int y1, int x2, int y2) {
+    return game_init(global_game, n, k, p, x1, y1, x2, y2);
+}
+
+int ai_turn() {
+    return game_ai_turn(global_game);
+}
+
+int move(int x1, int y1, int x2, int y2) {
+    return game_move(global_game, x1, y1, x2, y2);
+}
+
+int produce_knight(int x1, int y1, int x2, int y2) {
+    return game_produce_knight(global_game, x1, y1, x2, y2);
+}
+
+int produce_peasant(int x1, int y1, int x2, int y2) {
+    return game_produce_peasant(global_game, x1, y1, x2, y2);
+}
+
+int end_turn() {
+    return game_end_turn(global_game);
+}
+
+int ai_make_move() {
+    return game_ai_make_move(global_game);
+}
@@ -14,18 +14,37 @@
 #define ENGINE_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "print.h"
 
 typedef struct def_unit unit;
 
+/**
+ * State of a single match. All game_* functions work on the given state only,
+ * so separate matches can be played at the same time; functions without the
+ * prefix work on one global state.
+ */
+typedef struct def_board board;
+
 struct def_unit {
 char type;        // K,R,C - king, knight, peasant of first player; k,r or c - king, knight, peasant of second player
 	int x;            // x coordinate of the unit
 	int y;            // y coordinate of the unit
- 	int empty_rounds; // -1 means a move done in a current round; when =2 then peasant can produce new unit
- 	int ai_move;    // ai has already chosen what to do with the unit in this turn =1 YES, =0 NO
- 	unit *next;
+ 	int idle_since;   // number_of_rounds_left of the first round after the last action of the unit
+ 	unsigned int ai_epoch; // ai has already chosen what to do with the unit in this turn when equal to the epoch of the board
+ 	unsigned int id;  // order of creation, newer units have bigger ids
+ 	unsigned int slot; // position of the unit in arrays of units of its player
+ 	int cell_prev;    // neighbours in a bucket of the spatial index, as numbers of units
+ 	int cell_next;
+ 	int prev;         // previous unit on the list of units of its player, NO_UNIT for the head
+ 	int next;         // following unit on the list, see `game_next_unit`
 };
 
+/**
+ * Number of no unit. Units link each other by numbers, not pointers, see `game_snapshot`.
+ */
+#define NO_UNIT (-1)
+
 
  /**
  * Possible results from most functions in this module describing game state after they are finished.
@@ -51,6 +70,25 @@ enum MoveDirection {
 	WRONG_INPUT = 9
 };
 
+/**
+ * Kinds of AI playing `ai_make_move`.
+ */
+enum AiKind {
+	AI_GREEDY = 0,                // fixed policy: kings stay, knights charge, peasants produce
+	AI_SEARCH = 1,                // alpha-beta search limited by time
+	AI_MCTS = 2                   // Monte Carlo tree search with greedy rollouts, limited by time
+};
+
+/**
+ * Which AI plays and how long it may think about a single turn.
+ */
+typedef struct def_ai_options {
+	enum AiKind kind;
+	int budget_ms;                // time of a turn of `AI_SEARCH` and `AI_MCTS`; when it is not positive they play greedily
+	int workers;                  // threads running rollouts of `AI_MCTS`
+	bool ponder;                  // `AI_SEARCH` keeps searching on a background thread while the opponent moves
+} ai_options;
+
 /**
  * Initializes a game.
  * Returns `RESULT_WRONG_COMMAND` in a case of error.
@@ -114,18 +152,200 @@ void end_game();
 int ai_make_move();
 
 /**
-* Determines in which direction unit should move, assuming no obstacles
-*/
-enum MoveDirection find_best_move_towards(unit* ally, unit* enemy, bool peasant);
+ * Allocates a state for a new match. The match starts with `game_init`.
+ */
+board* game_create();
 
-static unit* find_unit(int x1, int y1);
+/**
+ * Frees memory of the match, leaving the state ready for another `game_init`.
+ */
+void game_clear(board *game);
 
 /**
-* Evaluates which one player is an owner of unit u.
-*/
-static int player(unit* u);
+ * Frees the state together with its match.
+ */
+void game_destroy(board *game);
+
+/**
+ * Makes AI of the given state print its commands into out instead of stdout.
+ */
+void game_set_output(board *game, output *out);
+
+/**
+ * `init` on the given state.
+ */
+int game_init(board *game, int n, int k, int p, int x1, int y1, int x2, int y2);
+
+/**
+ * `ai_turn` on the given state.
+ */
+int game_ai_turn(board *game);
+
+/**
+ * `move` on the given state.
+ */
+int game_move(board *game, int x1, int y1, int x2, int y2);
+
+/**
+ * `produce_knight` on the given state.
+ */
+int game_produce_knight(board *game, int x1, int y1, int x2, int y2);
+
+/**
+ * `produce_peasant` on the given state.
+ */
+int game_produce_peasant(board *game, int x1, int y1, int x2, int y2);
+
+/**
+ * `end_turn` on the given state.
+ */
+int game_end_turn(board *game);
+
+/**
+ * `ai_make_move` on the given state. The search and MCTS AIs play the best complete turn found
+ * within the budget, or the turn of the greedy AI if they found none.
+ */
+int game_ai_make_move(board *game);
+
+/**
+ * Makes the AI thinking in `game_ai_make_move` play the best turn it has found so far, at once.
+ * Can be called from any thread. Called when the AI is not thinking, or when it has stopped
+ * thinking already, it cuts short its next turn.
+ */
+void game_cancel_ai(board *game);
+
+/**
+ * Same as `game_move`, but records the move, so that `game_unmake` can take it back.
+ * An incorrect move returns `RESULT_WRONG_COMMAND`, leaves the state untouched
+ * and is not recorded. Units killed by recorded moves stay allocated until
+ * `game_clear_undo`.
+ */
+int game_make_move(board *game, int x1, int y1, int x2, int y2);
+
+/**
+ * Recorded `game_produce_knight`, see `game_make_move`.
+ */
+int game_make_produce_knight(board *game, int x1, int y1, int x2, int y2);
+
+/**
+ * Recorded `game_produce_peasant`, see `game_make_move`.
+ */
+int game_make_produce_peasant(board *game, int x1, int y1, int x2, int y2);
+
+/**
+ * Recorded `game_end_turn`, see `game_make_move`.
+ */
+int game_make_end_turn(board *game);
+
+/**
+ * Takes back the latest recorded action, restoring units, their positions and idle
+ * counters, turn and number of rounds left. State of AI is not restored.
+ * Returns `RESULT_WRONG_COMMAND` if there is nothing to take back, 0 otherwise.
+ */
+int game_unmake(board *game);
+
+/**
+ * Forgets all recorded actions, so that they can't be taken back anymore.
+ */
+void game_clear_undo(board *game);
+
+/**
+ * Plays the turn of the player to move, whichever it is, as the greedy AI does, printing its commands.
+ * The result is given from the point of view of the player of the AI, as for other actions.
+ */
+int game_greedy_turn(board *game);
+
+/**
+ * Makes dst a copy of the match in src, except for the output, the AI and the recorded actions,
+ * with a single memcpy of the state of src.
+ */
+void game_copy(board *dst, board *src);
+
+/**
+ * Flat copy of the state of a match.
+ */
+typedef struct def_snapshot {
+	void *data;
+	size_t bytes;
+	size_t capacity;
+} snapshot;
+
+/**
+ * Stores the state of the match in snap with a single memcpy. The whole state (units, their lists,
+ * index and arrays) lives in one buffer and refers to units by numbers, so it does not depend
+ * on where it lies in memory. snap has to be zeroed before the first use. Should be taken
+ * with no recorded actions, as units killed by them stay taken in restored games.
+ */
+void game_snapshot(board *game, snapshot *snap);
+
+/**
+ * Brings back the match stored by `game_snapshot` of any board, with a single memcpy.
+ * Recorded actions are forgotten. Pointers to units of the game are invalidated.
+ */
+void game_restore(board *game, const snapshot *snap);
+
+/**
+ * Frees memory of the snapshot.
+ */
+void snapshot_free(snapshot *snap);
+
+/**
+ * Chooses AI used by `game_ai_make_move`. The choice survives `game_clear`.
+ */
+void game_set_ai(board *game, const ai_options *options);
+
+/**
+ * Player whose turn it is, 1 or 2.
+ */
+int game_turn(board *game);
+
+/**
+ * Player the AI plays as, 1 or 2.
+ */
+int game_player(board *game);
+
+/**
+ * Size of the board.
+ */
+int game_size(board *game);
 
-static int is_not_peasant(unit *pawn);
+/**
+ * First unit on the list of units of player p, the newest first.
+ */
+unit* game_units(board *game, int p);
+
+/**
+ * Unit following u on the list of units of its player, NULL at the end.
+ */
+unit* game_next_unit(board *game, unit *u);
+
+/**
+ * Unit standing on (x, y), or NULL if the field is empty or lies outside the board.
+ */
+unit* game_unit_at(board *game, int x, int y);
+
+/**
+ * Unit of player p closest to (x, y) in an infinity norm, the newest among equally close ones;
+ * NULL if p has no units.
+ */
+unit* game_closest_unit(board *game, int p, int x, int y);
+
+/**
+ * Number of full rounds unit u has been idle for; -1 if it has already acted in the current round.
+ */
+int game_idle_rounds(board *game, unit *u);
+
+/**
+ * Zobrist hash of the position: units with their fields and the rounds they are idle since,
+ * the player to move and the number of rounds left. Positions reached by different orders
+ * of actions hash the same.
+ */
+uint64_t game_hash(board *game);
+
+/**
+* Determines in which direction unit should move, assuming no obstacles
+*/
+enum MoveDirection find_best_move_towards(board *game, unit* ally, unit* enemy, bool peasant);
 
 #endif /* ENGINE_H */
 
@@ -0,0 +1,453 @@
+ /** @file
+    Matches between two AI programs, refereed by the engine.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "dispatch.h"
+#include "match.h"
+
+/**
+ * Bytes of output of an AI read at once.
+ */
+#define LINK_BUFFER (1 << 16)
+
+/**
+ * Time given to AI to exit by themselves at the end of a match, as in game.sh.
+ */
+#define EXIT_GRACE_MS 200
+
+extern char **environ;
+
+/**
+ * Pipes to a running AI and its output read but not parsed yet.
+ */
+typedef struct def_player_link {
+    pid_t pid;
+    int to_fd;                    // stdin of the AI
+    int from_fd;                  // stdout of the AI
+    output out;                   // commands of the opponent, written to to_fd at every END_TURN
+    size_t start;                 // first byte of buffer not parsed yet
+    size_t end;
+    char buffer[LINK_BUFFER];
+} player_link;
+
+const char* match_end_name(enum MatchEnd end) {
+    static const char *const names[] = {
+        [MATCH_KING_TAKEN] = "KING_TAKEN",
+        [MATCH_ROUNDS_LIMIT] = "ROUNDS_LIMIT",
+        [MATCH_WRONG_COMMAND] = "WRONG_COMMAND",
+        [MATCH_EXITED] = "EXITED",
+        [MATCH_TIMEOUT] = "TIMEOUT",
+        [MATCH_OUT_OF_TURN] = "OUT_OF_TURN"
+    };
+
+    return names[end];
+}
+
+char** split_program(const char *line) {
+    size_t length = strlen(line);
+    size_t words = 0;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        words += line[i] != ' ' && (i == 0 || line[i - 1] == ' ');
+    }
+
+    // pointers to words, followed by a copy of line with spaces replaced by \0
+    char **argv = malloc((words + 1) * sizeof(char *) + length + 1);
+    char *copy = (char *) (argv + words + 1);
+    memcpy(copy, line, length + 1);
+
+    words = 0;
+    for (i = 0; i < length; i++) {
+        if (copy[i] == ' ') {
+            copy[i] = '\0';
+        } else if (i == 0 || line[i - 1] == ' ') {
+            argv[words++] = copy + i;
+        }
+    }
+    argv[words] = NULL;
+
+    return argv;
+}
+
+uint64_t match_random(uint64_t *state) {
+    uint64_t h = (*state += 0x9e3779b97f4a7c15ULL);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static bool too_close(int x1, int y1, int x2, int y2) {
+    return abs(x1 - x2) < MIN_START_DISTANCE && abs(y1 - y2) < MIN_START_DISTANCE;
+}
+
+/**
+ * Checks, as game.sh does, if both opposite corners of the area of kings are too close to (x, y).
+ * Otherwise one of them is a position for the other king.
+ */
+static bool no_place_for_other(int n, int x, int y) {
+    return too_close(x, y, 1, 1) && too_close(x, y, n - 3, n);
+}
+
+static void random_point(int n, uint64_t *seed, int *x, int *y) {
+    *x = 1 + (int) (match_random(seed) % (uint64_t) (n - 3));
+    *y = 1 + (int) (match_random(seed) % (uint64_t) n);
+}
+
+/**
+ * Picks a position at least `MIN_START_DISTANCE` away from (x, y), which has to exist.
+ */
+static void random_matching_point(int n, uint64_t *seed, int x, int y, int *matching_x, int *matching_y) {
+    do {
+        random_point(n, seed, matching_x, matching_y);
+    } while (too_close(x, y, *matching_x, *matching_y));
+}
+
+int pick_start_positions(int n, uint64_t *seed, int *x1, int *y1, int *x2, int *y2) {
+    bool given1 = *x1 != 0;
+    bool given2 = *x2 != 0;
+
+    if (given1 && given2) {
+        return too_close(*x1, *y1, *x2, *y2) ? -1 : 0;
+    }
+
+    if (!given1 && !given2) {
+        do {
+            random_point(n, seed, x1, y1);
+        } while (no_place_for_other(n, *x1, *y1));
+        given1 = true;
+    }
+
+    if (given1) {
+        if (no_place_for_other(n, *x1, *y1)) {
+            return -1;
+        }
+        random_matching_point(n, seed, *x1, *y1, x2, y2);
+    } else {
+        if (no_place_for_other(n, *x2, *y2)) {
+            return -1;
+        }
+        random_matching_point(n, seed, *x2, *y2, x1, y1);
+    }
+
+    return 0;
+}
+
+pid_t spawn_program(char *const argv[], int *to_fd, int *from_fd) {
+    posix_spawn_file_actions_t actions;
+    int input[2];
+    int output[2] = {-1, -1};
+    pid_t pid;
+
+    // close-on-exec keeps programs started later, e.g. by other matches, from holding the pipes open
+    if (pipe2(input, O_CLOEXEC) != 0) {
+        return -1;
+    }
+    if (from_fd != NULL && pipe2(output, O_CLOEXEC) != 0) {
+        close(input[0]);
+        close(input[1]);
+        return -1;
+    }
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+    if (from_fd != NULL) {
+        posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+    }
+    if (posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ) != 0) {
+        pid = -1;
+    }
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(input[0]);
+    if (from_fd != NULL) {
+        close(output[1]);
+    }
+    if (pid == -1) {
+        close(input[1]);
+        if (from_fd != NULL) {
+            close(output[0]);
+        }
+        return -1;
+    }
+
+    *to_fd = input[1];
+    if (from_fd != NULL) {
+        *from_fd = output[0];
+    }
+    return pid;
+}
+
+static long long now_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec pause = {ms / 1000, (long) (ms % 1000) * 1000000};
+    while (nanosleep(&pause, &pause) != 0 && errno == EINTR) {
+    }
+}
+
+/**
+ * Takes the next complete command out of the buffer of link.
+ * @return 1 when a command was taken, 0 when more input is needed, -1 for an incorrect command.
+ */
+static int take_command(player_link *link, bool binary, command *new_command) {
+    size_t available = link->end - link->start;
+    const char *line = link->buffer + link->start;
+
+    if (binary) {
+        if (available < COMMAND_RECORD_SIZE) {
+            return 0;
+        }
+        link->start += COMMAND_RECORD_SIZE;
+        return decode_command((const unsigned char *) line, new_command) == 0 ? 1 : -1;
+    }
+
+    const char *line_end = memchr(line, '\n', available);
+    if (line_end == NULL) {
+        return available > MAX_COMMAND_LENGTH ? -1 : 0; // error, too long line
+    }
+
+    size_t length = (size_t) (line_end - line) + 1;
+    link->start += length;
+    return parse_command_line(line, length, new_command) == 0 ? 1 : -1;
+}
+
+/**
+ * Reads whatever the AI has written.
+ * @return number of bytes read, 0 at the end of its output.
+ */
+static ssize_t fill(player_link *link) {
+    ssize_t bytes;
+
+    if (link->start > 0) {
+        memmove(link->buffer, link->buffer + link->start, link->end - link->start);
+        link->end -= link->start;
+        link->start = 0;
+    }
+
+    do {
+        bytes = read(link->from_fd, link->buffer + link->end, LINK_BUFFER - link->end);
+    } while (bytes < 0 && errno == EINTR);
+
+    if (bytes < 0) {
+        return 0; // a broken pipe ends the output as well
+    }
+    link->end += (size_t) bytes;
+    return bytes;
+}
+
+/**
+ * Closes pipes to the AI, gives it `EXIT_GRACE_MS` to exit and kills it otherwise.
+ * @return its exit code, or -1 when it did not exit by itself.
+ */
+static int stop_player(player_link *link, long long deadline) {
+    int status;
+    pid_t finished;
+
+    close(link->to_fd);
+    close(link->from_fd);
+
+    while ((finished = waitpid(link->pid, &status, WNOHANG)) == 0 && now_ms() < deadline) {
+        sleep_ms(1);
+    }
+    if (finished == 0) {
+        kill(link->pid, SIGKILL);
+        waitpid(link->pid, &status, 0);
+        return -1;
+    }
+
+    return finished == link->pid && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * Ends the match with the loss of player number loser (0 or 1).
+ */
+static void lose(match_result *result, int loser, enum MatchEnd end) {
+    result->winner = 2 - loser;
+    result->end = end;
+}
+
+/**
+ * Relays commands until the match is over, filling result.
+ */
+static void relay(const match_config *config, board *game, player_link links[2], output *tee, match_result *result) {
+    struct pollfd polled[2];
+    command new_command;
+    int mover = 0;
+    long long turn_start = now_ms();
+    int timeout;
+    int i;
+
+    while (true) {
+        int taken = take_command(&links[mover], config->binary, &new_command);
+
+        if (taken < 0) {
+            lose(result, mover, MATCH_WRONG_COMMAND);
+            return;
+        }
+
+        if (taken > 0) {
+            // poll checks the time only when the buffer runs dry, which a fast stream of commands never lets it
+            if (config->turn_timeout_ms > 0 && now_ms() > turn_start + config->turn_timeout_ms) {
+                lose(result, mover, MATCH_TIMEOUT);
+                return;
+            }
+
+            int exit_code = apply_command(game, &new_command);
+            if (exit_code == RESULT_WRONG_COMMAND) {
+                lose(result, mover, MATCH_WRONG_COMMAND);
+                return;
+            }
+
+            result->commands++;
+            print_command(&links[1 - mover].out, &new_command);
+            print_command(tee, &new_command);
+
+            if (exit_code != RESULT_ONGOING) {
+                // the opponent gets the last command, so that it can exit with the result as well
+                output_write(&links[1 - mover].out);
+                output_write(tee);
+                result->winner = exit_code == RESULT_WIN ? 1 : exit_code == RESULT_LOSE ? 2 : 0;
+                result->end = new_command.opcode == OPCODE_END_TURN ? MATCH_ROUNDS_LIMIT : MATCH_KING_TAKEN;
+                return;
+            }
+
+            if (new_command.opcode == OPCODE_END_TURN) {
+                if (links[mover].start != links[mover].end) {
+                    lose(result, mover, MATCH_OUT_OF_TURN);
+                    return;
+                }
+                if (config->turn_delay_ms > 0) {
+                    sleep_ms(config->turn_delay_ms);
+                }
+                mover = 1 - mover;
+                result->rounds += (mover == 0);
+                turn_start = now_ms();
+            }
+            continue;
+        }
+
+        // both AI are watched: the waiting one may exit or write out of turn as well
+        for (i = 0; i < 2; i++) {
+            polled[i].fd = links[i].from_fd;
+            polled[i].events = POLLIN;
+            polled[i].revents = 0;
+        }
+
+        timeout = -1;
+        if (config->turn_timeout_ms > 0) {
+            long long left = turn_start + config->turn_timeout_ms - now_ms();
+            timeout = left > 0 ? (int) left : 0;
+        }
+
+        int ready = poll(polled, 2, timeout);
+        if (ready < 0) {
+            continue; // EINTR
+        }
+        if (ready == 0) {
+            lose(result, mover, MATCH_TIMEOUT);
+            return;
+        }
+
+        if (polled[1 - mover].revents != 0) {
+            lose(result, 1 - mover, fill(&links[1 - mover]) > 0 ? MATCH_OUT_OF_TURN : MATCH_EXITED);
+            return;
+        }
+        if (polled[mover].revents != 0 && fill(&links[mover]) == 0) {
+            lose(result, mover, links[mover].start != links[mover].end ?
+                                MATCH_WRONG_COMMAND : MATCH_EXITED); // a command cut by the end of output is incorrect
+            return;
+        }
+    }
+}
+
+int play_match(const match_config *config, match_result *result) {
+    player_link *links = calloc(2, sizeof(player_link));
+    output tee;
+    command inits[2];
+    int i;
+
+    result->winner = 0;
+    result->end = MATCH_KING_TAKEN;
+    result->rounds = 1;
+    result->commands = 0;
+    result->exit_codes[0] = -1;
+    result->exit_codes[1] = -1;
+
+    for (i = 0; i < 2; i++) {
+        inits[i] = (command) {OPCODE_INIT, {config->n, config->k, i + 1,
+                                            config->x1, config->y1, config->x2, config->y2}};
+    }
+
+    // the referee is the engine of the first player, seeing all commands of both
+    board *game = game_create();
+    if (links == NULL || apply_command(game, &inits[0]) != RESULT_ONGOING) {
+        game_destroy(game);
+        free(links);
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++) {
+        links[i].pid = spawn_program(config->programs[i], &links[i].to_fd, &links[i].from_fd);
+        if (links[i].pid == -1) {
+            long long deadline = now_ms();
+            while (--i >= 0) {
+                stop_player(&links[i], deadline);
+            }
+            game_destroy(game);
+            free(links);
+            return -1;
+        }
+    }
+
+    output_init_writing(&tee, config->tee_fd, false, false);
+    if (config->tee_fd < 0) {
+        output_init_discarding(&tee);
+    }
+    print_command(&tee, &inits[0]);
+    print_command(&tee, &inits[1]);
+    output_write(&tee);
+
+    for (i = 0; i < 2; i++) {
+        output_init_writing(&links[i].out, links[i].to_fd, false, config->binary);
+        if (config->binary) {
+            print_line(&links[i].out, "%s", BINARY_HANDSHAKE); // the handshake itself is a line
+        }
+        print_command(&links[i].out, &inits[i]);
+        output_write(&links[i].out);
+    }
+
+    relay(config, game, links, &tee, result);
+
+    long long deadline = now_ms() + EXIT_GRACE_MS;
+    for (i = 0; i < 2; i++) {
+        result->exit_codes[i] = stop_player(&links[i], deadline);
+        output_free(&links[i].out);
+    }
+    output_free(&tee);
+    game_destroy(game);
+    free(links);
+    return 0;
+}
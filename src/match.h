@@ -0,0 +1,93 @@
+ /** @file
+    Interface of matches between two AI programs, refereed by the engine.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Smallest distance between kings at the start, as in `game_init`.
+ */
+#define MIN_START_DISTANCE 8
+
+/**
+ * Why a match has ended.
+ */
+enum MatchEnd {
+    MATCH_KING_TAKEN = 0,         // a king was killed, or both of them
+    MATCH_ROUNDS_LIMIT,           // the last round has ended
+    MATCH_WRONG_COMMAND,          // the loser sent an incorrect command or one the engine rejected
+    MATCH_EXITED,                 // the loser closed its output before the end of the match
+    MATCH_TIMEOUT,                // the loser did not finish its turn in time
+    MATCH_OUT_OF_TURN             // the loser wrote a command while the opponent was moving
+};
+
+/**
+ * Players and rules of a match.
+ */
+typedef struct def_match_config {
+    char *const *programs[2];     // NULL-terminated argv of AI of both players
+    int n;                        // size of the board
+    int k;                        // number of rounds
+    int x1, y1, x2, y2;           // positions of kings, see `pick_start_positions`
+    bool binary;                  // AI exchange binary records instead of lines
+    int turn_timeout_ms;          // a player thinking longer over a turn loses, not limited when not positive
+    int tee_fd;                   // every command is also written there as a line, e.g. to the GUI; -1 for none
+    int turn_delay_ms;            // pause after every turn, so that a match can be watched
+} match_config;
+
+typedef struct def_match_result {
+    int winner;                   // 1 or 2, 0 for a draw
+    enum MatchEnd end;
+    int rounds;                   // rounds begun, the last one possibly not finished
+    long long commands;           // correct commands of both players
+    int exit_codes[2];            // of AI processes, -1 when they were killed or did not exit in time
+} match_result;
+
+/**
+ * Name of the way a match has ended, e.g. `KING_TAKEN`.
+ */
+const char* match_end_name(enum MatchEnd end);
+
+/**
+ * Splits a command line at spaces, as the shell running game.sh does, e.g. "./middle_ages -ai mcts".
+ * @return NULL-terminated argv in a single block of memory, to be freed with free.
+ */
+char** split_program(const char *line);
+
+/**
+ * Next number of a splitmix64 generator with the given state.
+ */
+uint64_t match_random(uint64_t *state);
+
+/**
+ * Picks positions of kings as game.sh does: uniformly in the first n - 3 columns, at least
+ * `MIN_START_DISTANCE` apart. Coordinates given as 0 are picked, others are kept.
+ * @return 0, or -1 when the positions given leave no correct one.
+ */
+int pick_start_positions(int n, uint64_t *seed, int *x1, int *y1, int *x2, int *y2);
+
+/**
+ * Starts program with its stdin and, when from_fd is not NULL, its stdout connected
+ * to pipes, whose other ends are returned; the other ends are closed in later programs.
+ * @return pid of the program or -1.
+ */
+pid_t spawn_program(char *const argv[], int *to_fd, int *from_fd);
+
+/**
+ * Plays a match: starts both AI, sends them INIT, relays the commands of each player to the other
+ * a whole turn at once and checks every command with the engine. The first incorrect one,
+ * an exit or a timeout loses the match. Both AI are stopped at the end.
+ * Writing to an AI that has exited raises SIGPIPE, which the caller has to ignore.
+ * @return 0, or -1 when the match could not be started.
+ */
+int play_match(const match_config *config, match_result *result);
+
+#endif /* MATCH_H */
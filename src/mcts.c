@@ -0,0 +1,308 @@
+ /** @file
+    Monte Carlo tree search over whole turns of both players.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mcts.h"
+
+#define EXPLORATION 1.4           // weight of exploration in UCT
+#define ROLLOUT_TURNS 24          // turns of a rollout, after them the position is judged by material
+#define KNIGHT_WEIGHT 1
+#define PEASANT_WEIGHT 2
+
+/**
+ * Node of a tree, reached from its parent by a turn of one player.
+ */
+typedef struct def_node {
+    turn move;                    // turn leading from the parent, empty at the root
+    int mover;                    // player who played move
+    bool terminal;                // the game ends with move
+    double final_score;           // score of the ended game, see `final_score`
+    struct def_node *children;
+    int child_count;              // -1 until the node is expanded
+    unsigned int visits;
+    double score;                 // sum of scores of playouts through the node, for mover
+} node;
+
+typedef struct def_worker {
+    board *root;                  // searched game, only read by workers
+    const turn_limit *limit;
+    board *sim;                   // game played by playouts
+    output sink;                  // commands of rollouts go nowhere
+    node tree;
+    unsigned long playouts;
+    pthread_t thread;
+    bool started;                 // has its own thread; the first worker runs on the calling thread
+} worker;
+
+static void node_init(node *n, int mover) {
+    n->move.actions = NULL;
+    n->move.count = 0;
+    n->move.capacity = 0;
+    n->mover = mover;
+    n->terminal = false;
+    n->final_score = 0.0;
+    n->children = NULL;
+    n->child_count = -1;
+    n->visits = 0;
+    n->score = 0.0;
+}
+
+static void node_free(node *n) {
+    int i;
+    for (i = 0; i < n->child_count; i++) {
+        node_free(&n->children[i]);
+    }
+    free(n->children);
+    turn_free(&n->move);
+}
+
+/**
+ * Score of the ended game for player 1: 1 for a win, 0 for a loss and 1/2 for a draw.
+ */
+static double final_score(board *sim, int result) {
+    switch (result) {
+        case RESULT_WIN :
+            return game_player(sim) == 1 ? 1.0 : 0.0;
+        case RESULT_LOSE :
+            return game_player(sim) == 1 ? 0.0 : 1.0;
+        default :
+            return 0.5;
+    }
+}
+
+/**
+ * Score of an unfinished game for player 1: its share in the material of both players.
+ */
+static double material_score(board *sim) {
+    int material[2] = {0, 0};
+    int p;
+
+    for (p = 1; p <= 2; p++) {
+        unit *u;
+        for (u = game_units(sim, p); u != NULL; u = game_next_unit(sim, u)) {
+            if (u->type == 'r' || u->type == 'R') {
+                material[p - 1] += KNIGHT_WEIGHT;
+            } else if (u->type == 'c' || u->type == 'C') {
+                material[p - 1] += PEASANT_WEIGHT;
+            }
+        }
+    }
+
+    return material[0] + material[1] == 0 ? 0.5 : (double) material[0] / (material[0] + material[1]);
+}
+
+/**
+ * Plays turn t, ending it unless the game ends earlier, and returns the result.
+ */
+static int play_turn(board *sim, const turn *t) {
+    int result = RESULT_ONGOING;
+    size_t i;
+
+    for (i = 0; i < t->count && result == RESULT_ONGOING; i++) {
+        const action *a = &t->actions[i];
+        switch (a->kind) {
+            case ACTION_MOVE :
+                result = game_move(sim, a->x1, a->y1, a->x2, a->y2);
+                break;
+            case ACTION_PRODUCE_KNIGHT :
+                result = game_produce_knight(sim, a->x1, a->y1, a->x2, a->y2);
+                break;
+            default :
+                result = game_produce_peasant(sim, a->x1, a->y1, a->x2, a->y2);
+        }
+    }
+    if (result == RESULT_ONGOING) {
+        result = game_end_turn(sim);
+    }
+    assert(result != RESULT_WRONG_COMMAND);
+
+    return result;
+}
+
+/**
+ * Both players play greedily for at most `ROLLOUT_TURNS` turns, fewer if the limit is reached
+ * in the meantime, as a greedy turn of a big army takes a while. Returns the score for player 1.
+ */
+static double rollout(board *sim, const turn_limit *limit) {
+    int result = RESULT_ONGOING;
+    int i;
+
+    for (i = 0; i < ROLLOUT_TURNS && result == RESULT_ONGOING && !limit_reached(limit); i++) {
+        result = game_greedy_turn(sim);
+    }
+
+    return result == RESULT_ONGOING ? material_score(sim) : final_score(sim, result);
+}
+
+/**
+ * Creates children of node n for candidate turns in the current position of the simulated game.
+ */
+static void expand(board *sim, node *n) {
+    turn candidates[CANDIDATE_TURNS];
+    int i;
+
+    for (i = 0; i < CANDIDATE_TURNS; i++) {
+        candidates[i].actions = NULL;
+        candidates[i].count = 0;
+        candidates[i].capacity = 0;
+    }
+
+    n->child_count = search_candidates(sim, candidates);
+    n->children = malloc(n->child_count * sizeof(node));
+    for (i = 0; i < CANDIDATE_TURNS; i++) {
+        if (i < n->child_count) {
+            node_init(&n->children[i], game_turn(sim));
+            n->children[i].move = candidates[i];
+        } else {
+            turn_free(&candidates[i]);
+        }
+    }
+}
+
+/**
+ * Child of n with the highest upper confidence bound; unvisited children go first, in order.
+ */
+static node* select_child(node *n) {
+    double log_visits = log((double) n->visits);
+    node *best = NULL;
+    double best_bound = -1.0;
+    int i;
+
+    for (i = 0; i < n->child_count; i++) {
+        node *c = &n->children[i];
+        if (c->visits == 0) {
+            return c;
+        }
+
+        double bound = c->score / c->visits + EXPLORATION * sqrt(log_visits / c->visits);
+        if (bound > best_bound) {
+            best_bound = bound;
+            best = c;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Continues a playout from node n, whose position is on the simulated game: down the tree,
+ * expanding a visited leaf, or with a rollout from a new one. Returns the score for player 1.
+ */
+static double playout(board *sim, const turn_limit *limit, node *n) {
+    double score;
+
+    if (n->terminal) {
+        score = n->final_score;
+    } else if (n->child_count < 0 && n->visits == 0) {
+        score = rollout(sim, limit);
+    } else {
+        if (n->child_count < 0) {
+            expand(sim, n);
+        }
+
+        node *c = select_child(n);
+        int result = play_turn(sim, &c->move);
+        if (result != RESULT_ONGOING) {
+            c->terminal = true;
+            c->final_score = final_score(sim, result);
+        }
+        score = playout(sim, limit, c);
+    }
+
+    n->visits++;
+    n->score += n->mover == 1 ? score : 1.0 - score;
+    return score;
+}
+
+static void* work(void *arg) {
+    worker *w = (worker *) arg;
+
+    game_copy(w->sim, w->root);
+    expand(w->sim, &w->tree);
+    while (!limit_reached(w->limit)) {
+        game_copy(w->sim, w->root);
+        playout(w->sim, w->limit, &w->tree);
+        w->playouts++;
+    }
+
+    return NULL;
+}
+
+bool mcts_best_turn(board *game, const turn_limit *limit, int workers, turn *best) {
+    long long start = monotonic_ns();
+    worker *pool = malloc(workers * sizeof(worker));
+    unsigned int visits[CANDIDATE_TURNS] = {0};
+    unsigned long playouts = 0;
+    int running = 0;
+    int best_index = 0;
+    int i, j;
+
+    for (i = 0; i < workers; i++) {
+        worker *w = &pool[i];
+        w->root = game;
+        w->limit = limit;
+        w->sim = game_create();
+        output_init_discarding(&w->sink);
+        game_set_output(w->sim, &w->sink);
+        node_init(&w->tree, 3 - game_turn(game));
+        w->playouts = 0;
+        w->started = i > 0 && pthread_create(&w->thread, NULL, work, w) == 0;
+    }
+
+    work(&pool[0]); // so that there is a tree even when no thread could be started
+    for (i = 0; i < workers; i++) {
+        worker *w = &pool[i];
+        if (w->started) {
+            pthread_join(w->thread, NULL);
+        } else if (i > 0) {
+            continue; // its thread has not started, its tree is empty
+        }
+        running++;
+        for (j = 0; j < w->tree.child_count; j++) { // all trees have the same children of the root
+            visits[j] += w->tree.children[j].visits;
+        }
+        playouts += w->playouts;
+    }
+
+    for (j = 1; j < pool[0].tree.child_count; j++) {
+        if (visits[j] > visits[best_index]) {
+            best_index = j;
+        }
+    }
+
+    bool found = pool[0].tree.child_count > 0 && visits[best_index] > 0;
+    if (found) {
+        const turn *chosen = &pool[0].tree.children[best_index].move;
+        if (best->capacity < chosen->count) {
+            best->capacity = chosen->count;
+            best->actions = realloc(best->actions, best->capacity * sizeof(action));
+        }
+        best->count = chosen->count;
+        if (best->count > 0) {
+            memcpy(best->actions, chosen->actions, best->count * sizeof(action));
+        }
+    }
+
+    double seconds = (monotonic_ns() - start) / 1e9;
+    fprintf(stderr, "mcts: %lu playouts on %d workers in %.3f s, %.0f playouts/s\n",
+            playouts, running, seconds, seconds > 0 ? playouts / seconds : 0.0);
+
+    for (i = 0; i < workers; i++) {
+        node_free(&pool[i].tree);
+        game_destroy(pool[i].sim);
+        output_free(&pool[i].sink);
+    }
+    free(pool);
+
+    return found;
+}
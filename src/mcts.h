@@ -0,0 +1,25 @@
+ /** @file
+    Interface of Monte Carlo tree search over whole turns of both players.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "engine.h"
+#include "search.h"
+
+/**
+ * Chooses the best turn for the AI, whose turn it has to be, and stores it in best.
+ * Turns in the tree are the candidate turns of `search_candidates`; playouts leave the tree
+ * with a rollout played by the greedy AI for both players. Each of the workers threads grows
+ * its own tree on its own copy of the game (root parallelism) until the limit
+ * is reached; the turn visited most often in all trees is chosen.
+ * Reports the number of playouts per second on stderr. Leaves the game as it was.
+ * Returns false, leaving best untouched, when the limit is reached before any playout.
+ */
+bool mcts_best_turn(board *game, const turn_limit *limit, int workers, turn *best);
+
+#endif /* MCTS_H */
@@ -11,60 +11,127 @@
     @date 2016-08-26
  */
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "parse.h"
 #include "engine.h"
+#include "dispatch.h"
+#include "server.h"
+#include "reader.h"
 
-int main() {
-	start_game();
+#define DEFAULT_BUDGET_MS 500
+#define BUDGET_VARIABLE "MIDDLE_AGES_BUDGET_MS"
+
+static reader input; // outlives main, its thread may be still waiting for a line when the game ends
+
+static output answers; // commands of AI, written once per turn
+
+static int usage(char *name) {
+	fprintf(stderr, "Usage: %s [-ai greedy|search|mcts] [-budget ms] [-workers n] [-ponder] [-flush-lines] [-binary] [-server [-threads n]]\n", name);
+	return 1;
+}
+
+/**
+ * Usage: middle_ages [-ai greedy|search|mcts] [-budget ms] [-workers n] [-ponder] [-flush-lines] [-binary]
+ *                    [-server [-threads n]]
+ * Without -server plays a single game on stdin/stdout; commands are read and parsed on a separate thread
+ * and executed in batches of all the commands read so far.
+ * -ai chooses AI (greedy by default), -budget limits time of a single turn of the search and MCTS AIs
+ * (the default comes from MIDDLE_AGES_BUDGET_MS if it is set; when time runs out before a turn is found,
+ * the greedy AI plays it),
+ * -workers sets the number of threads running rollouts of the MCTS AI (all processors by default;
+ * in server mode they are split between the -threads playing games),
+ * -ponder lets the search AI think on a background thread while the opponent moves (not in server mode),
+ * -flush-lines writes every command of AI as soon as it is chosen, as an interactive GUI may expect,
+ * instead of the whole turn at once,
+ * -binary makes a single game read and print commands as fixed-size binary records (see
+ * `COMMAND_RECORD_SIZE`) instead of lines; input starting with the line `BINARY_HANDSHAKE` does the same.
+ */
+int main(int argc, char *argv[]) {
+	int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	ai_options ai = {AI_GREEDY, DEFAULT_BUDGET_MS, threads, false};
+	bool server = false;
+	bool threads_given = false;
+	bool flush_lines = false;
+	bool binary = false;
+	char *budget = getenv(BUDGET_VARIABLE);
+	int i;
+
+	if (budget != NULL) {
+		ai.budget_ms = atoi(budget);
+	}
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-server") == 0) {
+			server = true;
+		} else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+			threads_given = true;
+		} else if (strcmp(argv[i], "-budget") == 0 && i + 1 < argc) {
+			ai.budget_ms = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-ponder") == 0) {
+			ai.ponder = true;
+		} else if (strcmp(argv[i], "-flush-lines") == 0) {
+			flush_lines = true;
+		} else if (strcmp(argv[i], "-binary") == 0) {
+			binary = true;
+		} else if (strcmp(argv[i], "-workers") == 0 && i + 1 < argc) {
+			ai.workers = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-ai") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "greedy") == 0) {
+				ai.kind = AI_GREEDY;
+			} else if (strcmp(argv[i], "search") == 0) {
+				ai.kind = AI_SEARCH;
+			} else if (strcmp(argv[i], "mcts") == 0) {
+				ai.kind = AI_MCTS;
+			} else {
+				return usage(argv[0]);
+			}
+		} else {
+			return usage(argv[0]);
+		}
+	}
+
+	if (threads_given && !server) {
+		return usage(argv[0]); // -threads is an option of the server only
+	}
+
+	if (ai.workers < 1) {
+		ai.workers = 1;
+	}
+
+	if (server) {
+		return run_server(threads < 1 ? 1 : threads, &ai);
+	}
+
+	if (reader_start(&input, binary) != 0) {
+		fprintf(stderr, "cannot start the reader thread\n");
+		return 1;
+	}
+
+	board *game = game_create();
+	game_set_ai(game, &ai);
+	output_init_writing(&answers, STDOUT_FILENO, flush_lines, input.input.binary);
+	game_set_output(game, &answers);
 
 	int exit_code = RESULT_ONGOING;
-	command *new_command = NULL;
     while (exit_code == RESULT_ONGOING) {
-		free(new_command);
-		new_command = parse_command();
-
-		if (strcmp(new_command->name, "INIT") == 0) {
-			exit_code = init(new_command->data[0],
-							 new_command->data[1],
-							 new_command->data[2],
-							 new_command->data[3],
-							 new_command->data[4],
-							 new_command->data[5],
-							 new_command->data[6]);
-
-			if (exit_code == RESULT_ONGOING && ai_turn()) {
-				exit_code = ai_make_move();
-			}
-		} else if (strcmp(new_command->name, "PRODUCE_KNIGHT") == 0) {
-			exit_code = produce_knight(new_command->data[0],
-									   new_command->data[1],
-									   new_command->data[2],
-									   new_command->data[3]);
-		} else if (strcmp(new_command->name, "PRODUCE_PEASANT") == 0) {
-			exit_code = produce_peasant(new_command->data[0],
-										new_command->data[1],
-										new_command->data[2],
-										new_command->data[3]);
-		} else if (strcmp(new_command->name, "MOVE") == 0) {
-			exit_code = move(new_command->data[0],
-							 new_command->data[1],
-							 new_command->data[2],
-							 new_command->data[3]);
-		} else if (strcmp(new_command->name, "END_TURN") == 0) {
-			exit_code = end_turn();
-
-			if (exit_code == RESULT_ONGOING && ai_turn()) {
-				exit_code = ai_make_move();
-			}
+		size_t ready = command_queue_wait(&input.queue);
+		size_t executed = 0;
+		while (executed < ready && exit_code == RESULT_ONGOING) {
+			exit_code = execute_command(game, command_queue_peek(&input.queue, executed++));
 		}
+		command_queue_pop(&input.queue, executed);
     }
 
-	free(new_command);
-	end_game();
+	output_write(&answers); // a turn of AI cut short by the end of the game
+	game_destroy(game);
+	output_free(&answers);
 
     return exit_code;
 }
@@ -7,177 +7,418 @@
     @date 2016-04-26
  */
 
-#include <stdlib.h>
-#include <stdio.h>
+#include <stdint.h>
 #include <string.h>
-#include <ctype.h>
 #include <limits.h>
 #include <errno.h>
+#include <unistd.h>
 
-#define WRONG_COMMAND_EXIT_CODE 42
+#include "parse.h"
 
-#define MAX_COMMAND_LENGTH 100
-#define BUFFER_LENGTH (MAX_COMMAND_LENGTH + 1)
+/**
+ * Length of the name and number of numbers of commands of each opcode.
+ */
+static const size_t name_lengths[OPCODE_COUNT] = {0, 4, 4, 14, 15, 8};
+static const int data_points[OPCODE_COUNT] = {0, 7, 4, 4, 4, 0};
 
-#define TO_STRING(X) #X
-#define STRING_FMT(LEN) "%" TO_STRING(LEN) "s"
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2_PARSER
+#endif
 
-typedef struct def_command {
-	char name[16];
-	int data[7];
-} command;
+/**
+ * Bytes read at once by the vector parser: a line is looked at in its first `VECTOR_LINE` bytes,
+ * and a number of up to 8 digits starting there is read as a whole word.
+ */
+#define VECTOR_LINE 32
+#define VECTOR_READ (VECTOR_LINE + 8)
 
-int parsing_failure_exit(char *allocated_memory1, command *allocated_memory2) {
-	free(allocated_memory1);
-	free(allocated_memory2);
-	exit(WRONG_COMMAND_EXIT_CODE);
+static int is_digit(char c) {
+	return c >= '0' && c <= '9';
 }
 
-int buffer_overflow(char *buffer, int buffer_length) {
-	return (strlen(buffer) == buffer_length - 1 && buffer[strlen(buffer)-1] != '\n');
+#ifdef HAVE_SSE2_PARSER
+/**
+ * Bit mask of bytes of the 32 bytes at line equal to c.
+ */
+static uint32_t bytes_equal(__m128i low, __m128i high, char c) {
+	__m128i value = _mm_set1_epi8(c);
+	return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(low, value)) |
+	       (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(high, value)) << 16;
 }
 
-int count_singular_spaces_in_buffer(char *s) {
-	int i;
-	int s_length = strlen(s);
-	int space_counter = 0;
+/**
+ * Bit mask of digits among the 32 bytes at line.
+ */
+static uint32_t bytes_digits(__m128i low, __m128i high) {
+	__m128i below = _mm_set1_epi8('0' - 1);
+	__m128i above = _mm_set1_epi8('9' + 1);
+	return (uint32_t) _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(low, below), _mm_cmplt_epi8(low, above))) |
+	       (uint32_t) _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(high, below), _mm_cmplt_epi8(high, above))) << 16;
+}
 
-	if (!isalpha(s[0])) {
+/**
+ * Value of count (1 to 8) digits at p, read as one word with a digit in every byte;
+ * 8 bytes at p can be read.
+ */
+static int digits_value(const char *p, int count) {
+	uint64_t lanes;
+	memcpy(&lanes, p, sizeof(lanes));
+
+	lanes <<= 64 - 8 * count; // bytes after the number become leading zeros
+	lanes = (lanes & 0x0f0f0f0f0f0f0f0fULL) * 2561 >> 8;
+	lanes = (lanes & 0x00ff00ff00ff00ffULL) * 6553601 >> 16;
+	return (int) ((lanes & 0x0000ffff0000ffffULL) * 42949672960001ULL >> 32);
+}
+
+/**
+ * Parses the numbers after the command name of `name_length` bytes, classifying all bytes of
+ * the line at once instead of one by one. `VECTOR_READ` bytes at line can be read.
+ * @return 1 with *newline set for a correct command, 0 for an incorrect one and -1 when the line
+ * is too long, or has too long numbers, to be parsed this way.
+ */
+static int parse_numbers_vector(const char *line, int name_length, int numbers, int *data,
+                                const char **newline) {
+	__m128i low = _mm_loadu_si128((const __m128i *) line);
+	__m128i high = _mm_loadu_si128((const __m128i *) (line + 16));
+	uint32_t newlines = bytes_equal(low, high, '\n');
+	if (newlines == 0) {
 		return -1;
 	}
 
-	for (i = 1; i < s_length-1; i++) {
-		if (isspace(s[i])) {
-			if (s[i] != ' ') {
-				return -1;
-			}
-			else {
-				if (isdigit(s[i+1])) { // s[i+1] is always accessible
-					++space_counter;
-				}
-				else {
-					return -1;
-				}
-			}
-		}
+	int end = __builtin_ctz(newlines); // not within the name, which has no \n
+	uint32_t after_name = ((1u << end) - 1) & ~((1u << name_length) - 1);
+	uint32_t spaces = bytes_equal(low, high, ' ') & after_name;
+	uint32_t digits = bytes_digits(low, high);
+
+	if (((spaces | digits) & after_name) != after_name || (spaces << 1) & ~digits ||
+	    (after_name != 0 && !(spaces >> name_length & 1))) {
+		return 0; // error, something else than single spaces before numbers after the name
 	}
 
-	if (s[s_length-1] != '\n') {
-		return -1;
+	int i;
+	for (i = 0; i < numbers; i++) {
+		if (spaces == 0) {
+			return 0; // error, too few numbers
+		}
+
+		int start = __builtin_ctz(spaces) + 1;
+		spaces &= spaces - 1;
+		int count = (spaces != 0 ? __builtin_ctz(spaces) : end) - start;
+		if (count > 8) {
+			return -1;
+		}
+
+		data[i] = digits_value(line + start, count);
+		if (data[i] == 0) {
+			return 0; // error, less than 1
+		}
 	}
 
-	return space_counter;
+	if (spaces != 0) {
+		return 0; // error, too many numbers
+	}
+	*newline = line + end;
+	return 1;
 }
+#endif
+
+/**
+ * Parses a command starting at line. Bytes up to readable_end can be read, and there is \n
+ * before it, so that every scan stops at the latest there.
+ * @return the \n ending the command, NULL if the line is not a correct command.
+ */
+static const char* parse_command_at(const char *line, const char *readable_end, command *new_command) {
+	size_t limit = (size_t) (readable_end - line);
+	enum Opcode opcode;
+	int known;
+
+	// the first letter tells which command it can be, the rest only has to agree
+	switch (line[0]) {
+		case 'I':
+			opcode = OPCODE_INIT;
+			known = limit > 4 && memcmp(line, "INIT", 4) == 0;
+			break;
+		case 'M':
+			opcode = OPCODE_MOVE;
+			known = limit > 4 && memcmp(line, "MOVE", 4) == 0;
+			break;
+		case 'P':
+			if (limit > 14 && memcmp(line, "PRODUCE_KNIGHT", 14) == 0) {
+				opcode = OPCODE_PRODUCE_KNIGHT;
+				known = 1;
+			} else {
+				opcode = OPCODE_PRODUCE_PEASANT;
+				known = limit > 15 && memcmp(line, "PRODUCE_PEASANT", 15) == 0;
+			}
+			break;
+		case 'E':
+			opcode = OPCODE_END_TURN;
+			known = limit > 8 && memcmp(line, "END_TURN", 8) == 0;
+			break;
+		default:
+			return NULL; // error, unknown command
+	}
+
+	if (!known) {
+		return NULL; // error, unknown command
+	}
+	new_command->opcode = opcode;
+
+	const char *p = line + name_lengths[opcode];
+
+#ifdef HAVE_SSE2_PARSER
+	if (readable_end - line >= VECTOR_READ) {
+		const char *newline;
+		int parsed = parse_numbers_vector(line, (int) name_lengths[opcode], data_points[opcode],
+		                                  new_command->data, &newline);
+		if (parsed >= 0) {
+			return parsed ? newline : NULL;
+		}
+	}
+#endif
 
-int first_space(char *s) {
 	int i;
-	int s_length = strlen(s);
-	for (i = 0; i <= s_length; i++) {
-		if (s[i] == ' ') {
-			return i;
+	for (i = 0; i < data_points[opcode]; i++) {
+		if (*p != ' ' || !is_digit(p[1])) {
+			return NULL; // error, missing number, other whitespace, double space or a longer name
 		}
+		p++;
+
+		long long value = 0;
+		do {
+			value = value * 10 + (*p - '0');
+			if (value > INT_MAX) {
+				return NULL; // error, too big for int
+			}
+			p++;
+		} while (is_digit(*p)); // stops at the \n at the latest
+
+		if (value == 0) {
+			return NULL; // error, less than 1
+		}
+		new_command->data[i] = (int) value;
 	}
 
-	return -1;
+	return *p == '\n' ? p : NULL; // error, anything else after the command
 }
 
-int nonumbers_after_command_name(char *input, int first_space_in_buffer) {
-	if (first_space_in_buffer == -1) {
-		return 0;
+int parse_command_line(const char *line, size_t length, command *new_command) {
+	if (length == 0 || length > MAX_COMMAND_LENGTH || line[length - 1] != '\n') {
+		return -1; // error, empty or too long line, or EOF before \n
 	}
 
+	// the command has to end at the only \n of the line
+	return parse_command_at(line, line + length, new_command) == line + length - 1 ? 0 : -1;
+}
+
+int parse_line(char *input, command *new_command) {
+	return parse_command_line(input, strlen(input), new_command);
+}
+
+/**
+ * Writes value as 4 little-endian bytes.
+ */
+static void put_int32(unsigned char *bytes, uint32_t value) {
+	bytes[0] = (unsigned char) value;
+	bytes[1] = (unsigned char) (value >> 8);
+	bytes[2] = (unsigned char) (value >> 16);
+	bytes[3] = (unsigned char) (value >> 24);
+}
+
+/**
+ * Reads 4 little-endian bytes.
+ */
+static uint32_t get_int32(const unsigned char *bytes) {
+	return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+void encode_command(const command *new_command, unsigned char *record) {
 	int i;
-	int input_length = strlen(input);
-	for (i = first_space_in_buffer; i <= input_length-2; i++) {
-		if (input[i] != ' ' && !isdigit(input[i])) {
-			return 1;
+
+	put_int32(record, (uint32_t) new_command->opcode);
+	for (i = 0; i < 7; i++) {
+		put_int32(record + 4 * (i + 1), i < data_points[new_command->opcode] ? (uint32_t) new_command->data[i] : 0);
+	}
+}
+
+int decode_command(const unsigned char *record, command *new_command) {
+	uint32_t opcode = get_int32(record);
+	int i;
+
+	if (opcode == OPCODE_WRONG || opcode >= OPCODE_COUNT) {
+		return -1; // error, unknown command
+	}
+
+	new_command->opcode = (enum Opcode) opcode;
+	for (i = 0; i < 7; i++) {
+		uint32_t value = get_int32(record + 4 * (i + 1));
+		if (i < data_points[opcode] ? value == 0 || value > INT_MAX : value != 0) {
+			return -1; // error, a number less than 1 or too big for int, or one too many
 		}
+		new_command->data[i] = (int) value;
 	}
 
 	return 0;
 }
 
-command* parse_command() {
-    char *input = calloc(BUFFER_LENGTH, sizeof(char));
+void command_stream_init(command_stream *stream, int fd, int binary) {
+	stream->fd = fd;
+	stream->start = 0;
+	stream->scanned = 0;
+	stream->end = 0;
+	stream->eof = 0;
+	stream->skipping = 0;
+	stream->binary = binary;
+	stream->next_line = 0;
+	stream->lines = 0;
+}
 
-	if (fgets(input, BUFFER_LENGTH, stdin) == NULL || buffer_overflow(input, BUFFER_LENGTH)) {
-		parsing_failure_exit(input, NULL); // error of reading, EOF before \n or buffer overflow
+/**
+ * Moves the unparsed bytes to the front of the buffer and reads more after them.
+ * All line ends found have to be parsed already.
+ */
+static void refill(command_stream *stream) {
+	size_t left = stream->end - stream->start;
+	ssize_t bytes;
+
+	memmove(stream->buffer, stream->buffer + stream->start, left);
+	stream->start = 0;
+	stream->scanned = left;       // they have no \n
+	stream->end = left;
+
+	do {
+		bytes = read(stream->fd, stream->buffer + left, COMMAND_STREAM_BLOCK - left);
+	} while (bytes < 0 && errno == EINTR);
+
+	if (bytes <= 0) {
+		stream->eof = 1; // a read error ends the input as well
+	} else {
+		stream->end += (size_t) bytes;
 	}
+}
+
+/**
+ * Finds further line ends among the bytes read, as many as fit in line_ends.
+ * All line ends found before have to be parsed already.
+ */
+static void find_lines(command_stream *stream) {
+	stream->next_line = 0;
+	stream->lines = 0;
+
+#ifdef HAVE_SSE2_PARSER
+	__m128i newline = _mm_set1_epi8('\n');
+	while (stream->scanned < stream->end && stream->lines + 16 <= COMMAND_STREAM_LINES) {
+		// 16 bytes at once; those after the end are read from the spare room of the buffer and dropped
+		const __m128i *bytes = (const __m128i *) (stream->buffer + stream->scanned);
+		uint32_t found = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(bytes), newline));
+		if (stream->end - stream->scanned < 16) {
+			found &= (1u << (stream->end - stream->scanned)) - 1;
+		}
 
-	int data_points = count_singular_spaces_in_buffer(input);
-	if (data_points < 0) {
-		parsing_failure_exit(input, NULL); // error, whitespace characters different than space (before \n\0) or double spaces
+		while (found != 0) {
+			stream->line_ends[stream->lines++] = (unsigned int) stream->scanned + __builtin_ctz(found);
+			found &= found - 1;
+		}
+		stream->scanned += 16;
+	}
+	if (stream->scanned > stream->end) {
+		stream->scanned = stream->end;
+	}
+#else
+	while (stream->scanned < stream->end && stream->lines < COMMAND_STREAM_LINES) {
+		char *found = memchr(stream->buffer + stream->scanned, '\n', stream->end - stream->scanned);
+		if (found == NULL) {
+			stream->scanned = stream->end;
+		} else {
+			stream->line_ends[stream->lines++] = (unsigned int) (found - stream->buffer);
+			stream->scanned = (size_t) (found - stream->buffer) + 1;
+		}
 	}
+#endif
+}
 
-	command *new_command = malloc(sizeof(command));
+int command_stream_handshake(command_stream *stream) {
+	size_t length = strlen(BINARY_HANDSHAKE);
 
-	// command name parsing
-	int first_space_in_buffer = first_space(input);
-	if (first_space_in_buffer > 15) {	
-		parsing_failure_exit(input, new_command); // error, too long command name
+	while (stream->end - stream->start < length && !stream->eof &&
+	       memchr(stream->buffer + stream->start, '\n', stream->end - stream->start) == NULL) {
+		refill(stream);
 	}
 
-	if (nonumbers_after_command_name(input, first_space_in_buffer)) {
-		parsing_failure_exit(input, new_command); // error, no digits after command name
+	if (stream->end - stream->start < length || memcmp(stream->buffer + stream->start, BINARY_HANDSHAKE, length) != 0) {
+		return 0;
 	}
 
-	sscanf(input, "%15s", new_command->name);
+	stream->start += length;
+	stream->scanned = stream->start;
+	stream->binary = 1;
+	return 1;
+}
 
-    if (strcmp(new_command->name, "END_TURN") == 0) {
-		if (data_points != 0) {
-			parsing_failure_exit(input, new_command);			
+/**
+ * Reads the next binary record of the stream into new_command.
+ */
+static int next_record(command_stream *stream, command *new_command) {
+	while (stream->end - stream->start < COMMAND_RECORD_SIZE) {
+		if (stream->eof) {
+			if (stream->end == stream->start) {
+				return COMMAND_STREAM_END;
+			}
+			stream->start = stream->end;
+			return -1; // error, EOF within a record
 		}
+		refill(stream);
 	}
-    else {
-		int known_command = 0;
-		if (strcmp(new_command->name, "INIT") == 0) {
-			if (data_points != 7) {
-				parsing_failure_exit(input, new_command);
-			}
 
-			known_command = 1;
-		}
-		if (strcmp(new_command->name, "MOVE") == 0)	{
-			if (data_points != 4) {
-				parsing_failure_exit(input, new_command);
-			}
+	const unsigned char *record = (const unsigned char *) stream->buffer + stream->start;
+	stream->start += COMMAND_RECORD_SIZE;
+	return decode_command(record, new_command);
+}
 
-			known_command = 1;
-		}
-		if (strcmp(new_command->name, "PRODUCE_KNIGHT") == 0) {
-			if (data_points != 4) {
-				parsing_failure_exit(input, new_command);;	
-			}
+int command_stream_next(command_stream *stream, command *new_command) {
+	if (stream->binary) {
+		return next_record(stream, new_command);
+	}
 
-			known_command = 1;
+	while (stream->next_line == stream->lines) {
+		if (stream->scanned < stream->end) {
+			find_lines(stream);
+			continue;
 		}
-		if (strcmp(new_command->name, "PRODUCE_PEASANT") == 0) {
-			if (data_points != 4) {
-				parsing_failure_exit(input, new_command);
-			}
 
-			known_command = 1;
+		// no \n after start: the line is cut by the end of the bytes read
+		size_t left = stream->end - stream->start;
+		if (left >= MAX_COMMAND_LENGTH) {
+			stream->skipping = 1; // error, too long line, dropped until its \n
+			stream->start = stream->end;
+			left = 0;
 		}
 
-		if ( known_command != 1 ) { // error, unknown command
-			parsing_failure_exit(input, new_command);
+		if (stream->eof) {
+			if (left == 0 && !stream->skipping) {
+				return COMMAND_STREAM_END;
+			}
+			stream->start = stream->end;
+			stream->skipping = 0;
+			return -1; // error, EOF before \n
 		}
 
-		int i;
-		long int data_long;
-		char *pointer_end_of_reading = input+first_space_in_buffer+1;
-		for (i = 0; i < data_points ; i++) {
-			data_long = strtol(pointer_end_of_reading, &pointer_end_of_reading, 10);
+		// read only when no complete line is left, so that a command read is not kept
+		// waiting for the next ones
+		refill(stream);
+	}
 
-			// too big for int or less than 1
-			if (data_long > INT_MAX || errno == ERANGE || data_long <= 0) {
-				parsing_failure_exit(input, new_command);
-			}
+	const char *line = stream->buffer + stream->start;
+	const char *newline = stream->buffer + stream->line_ends[stream->next_line++];
+	stream->start = (size_t) (newline - stream->buffer) + 1;
 
-			new_command->data[i] = (int) data_long;
-		}
+	if (stream->skipping) {
+		stream->skipping = 0;
+		return -1;
 	}
-
-	free(input);
-	return new_command;
+	if (newline - line >= MAX_COMMAND_LENGTH) {
+		return -1; // error, too long line
+	}
+	return parse_command_at(line, stream->buffer + sizeof(stream->buffer), new_command) == newline ? 0 : -1;
 }
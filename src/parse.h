@@ -10,14 +10,121 @@
 #ifndef PARSE_H
 #define PARSE_H
 
+#include <stddef.h>
+
+/**
+ * Longest correct command, without the terminating \0.
+ */
+#define MAX_COMMAND_LENGTH 100
+
+/**
+ * Number of bytes a command stream reads from its file at once.
+ */
+#define COMMAND_STREAM_BLOCK (1 << 16)
+
+/**
+ * Number of line ends a command stream finds at once, before parsing the lines.
+ */
+#define COMMAND_STREAM_LINES 256
+
+/**
+ * Value returned by `command_stream_next` at the end of input.
+ */
+#define COMMAND_STREAM_END 1
+
+/**
+ * First line of input switching both directions of a game to binary records.
+ */
+#define BINARY_HANDSHAKE "BINARY\n"
+
+/**
+ * Size of a command in the binary protocol: opcode and 7 numbers, each a little-endian
+ * 32-bit integer. Numbers not used by the command are 0.
+ */
+#define COMMAND_RECORD_SIZE 32
+
+/**
+ * Kind of a command, recognized once by the parser.
+ */
+enum Opcode {
+	OPCODE_WRONG = 0,             // incorrect line or the end of input, ending the game with RESULT_WRONG_COMMAND
+	OPCODE_INIT,
+	OPCODE_MOVE,
+	OPCODE_PRODUCE_KNIGHT,
+	OPCODE_PRODUCE_PEASANT,
+	OPCODE_END_TURN,
+	OPCODE_COUNT
+};
+
 /** Reads a command.
   returns 1 if the command is "END_TURN" and 0 otherwise.
   */
 typedef struct def_command {
-	char name[16];
+	enum Opcode opcode;
 	int data[7];
 } command;
 
-command* parse_command();
+/**
+ * Input read in blocks, from which lines are parsed in place, without copying them.
+ * Ends of lines are first found for many lines at once, so that parsing a line does not
+ * wait for the end of the one before.
+ */
+typedef struct def_command_stream {
+	int fd;
+	size_t start;                 // first byte not parsed yet
+	size_t scanned;               // bytes before it are searched for \n already
+	size_t end;                   // end of bytes read
+	int eof;                      // nothing more can be read from fd
+	int skipping;                 // the line at start is too long and is being dropped
+	int binary;                   // commands come as binary records instead of lines
+	unsigned int next_line;       // first of line_ends not parsed yet
+	unsigned int lines;           // number of line_ends found
+	unsigned int line_ends[COMMAND_STREAM_LINES]; // positions of \n in buffer
+	char buffer[COMMAND_STREAM_BLOCK + 64]; // with room to read whole vectors after the end
+} command_stream;
+
+/**
+ * Parses a single line (ending with \n) into new_command.
+ * @return 0 if the line is a correct command, -1 otherwise.
+ */
+int parse_line(char *input, command *new_command);
+
+/**
+ * Parses `length` bytes of line, the last of which has to be \n, into new_command.
+ * @return 0 if the line is a correct command, -1 otherwise.
+ */
+int parse_command_line(const char *line, size_t length, command *new_command);
+
+/**
+ * Writes new_command as a binary record of `COMMAND_RECORD_SIZE` bytes.
+ */
+void encode_command(const command *new_command, unsigned char *record);
+
+/**
+ * Reads a binary record of `COMMAND_RECORD_SIZE` bytes into new_command, with the same checks
+ * as a line of text: a known opcode, its numbers between 1 and INT_MAX and the others 0.
+ * @return 0 if the record is a correct command, -1 otherwise.
+ */
+int decode_command(const unsigned char *record, command *new_command);
+
+/**
+ * Prepares a stream reading lines, or binary records if binary, from the file descriptor fd.
+ */
+void command_stream_init(command_stream *stream, int fd, int binary);
+
+/**
+ * Waits for the first line of the stream and, if it is `BINARY_HANDSHAKE`, drops it and switches
+ * the stream to binary records. Other lines are left to be read as commands.
+ * @return 1 if the stream switched to binary records, 0 otherwise.
+ */
+int command_stream_handshake(command_stream *stream);
+
+/**
+ * Reads and parses the next line, or record, of the stream into new_command. A line too long
+ * to be a command is skipped up to its end without being kept in memory, so reading can go on after it.
+ * @return 0 for a correct command, -1 for an incorrect line or record (also a last line without \n
+ * or a cut record) and `COMMAND_STREAM_END` at the end of input.
+ */
+int command_stream_next(command_stream *stream, command *new_command);
 
 #endif /* PARSE_H */
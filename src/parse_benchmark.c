@@ -0,0 +1,72 @@
+ /** @file
+    Benchmark of the game protocol parser.
+
+    Parses a file of commands, e.g. a recorded game, a number of times and prints
+    the number of commands parsed per second. A file starting with the binary protocol
+    handshake is parsed as binary records:
+
+        parse_benchmark FILE [PASSES]
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "parse.h"
+
+#define DEFAULT_PASSES 100
+
+static command_stream stream;
+
+static double seconds_now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    command parsed;
+    long long correct = 0;
+    long long incorrect = 0;
+    long long checksum = 0;     // keeps the parsed data in use
+    int passes = argc > 2 ? atoi(argv[2]) : DEFAULT_PASSES;
+    int fd;
+    int i;
+    int result;
+
+    if (argc < 2 || passes <= 0) {
+        fprintf(stderr, "usage: %s FILE [PASSES]\n", argv[0]);
+        return 1;
+    }
+
+    fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    double started = seconds_now();
+    for (i = 0; i < passes; i++) {
+        lseek(fd, 0, SEEK_SET);
+        command_stream_init(&stream, fd, 0);
+        command_stream_handshake(&stream);
+        while ((result = command_stream_next(&stream, &parsed)) != COMMAND_STREAM_END) {
+            if (result == 0) {
+                correct++;
+                checksum += parsed.data[0];
+            } else {
+                incorrect++;
+            }
+        }
+    }
+    double elapsed = seconds_now() - started;
+    close(fd);
+
+    printf("%lld commands (%lld incorrect lines) in %.3f s: %.1fM commands/s (checksum %lld)\n",
+           correct, incorrect, elapsed, (correct + incorrect) / elapsed / 1e6, checksum);
+    return 0;
+}
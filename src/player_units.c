@@ -0,0 +1,293 @@
+ /** @file
+    Units of a single player stored as a structure of arrays.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "engine.h"
+#include "player_units.h"
+#include "distance_kernel.h"
+
+/**
+ * Number of the bucket holding coordinate c.
+ */
+static int cell_of(int c) {
+    return (c - 1) / CELL_SIZE + 1;
+}
+
+/**
+ * Number of bytes rounded up to a multiple of 8.
+ */
+static size_t aligned(size_t bytes) {
+    return (bytes + 7) & ~(size_t) 7;
+}
+
+size_t player_units_bytes(int n, unsigned int capacity) {
+    return 5 * aligned(capacity * sizeof(int)) + aligned(capacity * sizeof(char)) +
+           unit_index_bytes(cell_of(n), capacity);
+}
+
+/**
+ * Points arrays of pu, for pu->capacity units, to consecutive parts of memory.
+ * Returns memory left for the buckets.
+ */
+static char* carve(player_units *pu, char *memory) {
+    size_t ints = aligned(pu->capacity * sizeof(int));
+
+    pu->x = (int *) memory;
+    pu->y = (int *) (memory + ints);
+    pu->idle_since = (int *) (memory + 2 * ints);
+    pu->id = (unsigned int *) (memory + 3 * ints);
+    pu->units = (int *) (memory + 4 * ints);
+    pu->type = memory + 5 * ints;
+    return memory + 5 * ints + aligned(pu->capacity * sizeof(char));
+}
+
+void player_units_init(player_units *pu, int n, unsigned int capacity, unit *base, void *memory) {
+    pu->base = base;
+    pu->count = 0;
+    pu->capacity = capacity;
+    unit_index_init(&pu->cells, cell_of(n), capacity, carve(pu, memory));
+}
+
+void player_units_bind(player_units *pu, unit *base, void *memory) {
+    pu->base = base;
+    unit_index_bind(&pu->cells, carve(pu, memory));
+}
+
+void player_units_copy(player_units *pu, const player_units *from, unsigned int capacity, unit *base, void *memory) {
+    pu->base = base;
+    pu->count = from->count;
+    pu->capacity = capacity;
+    char *cells = carve(pu, memory);
+
+    memcpy(pu->x, from->x, from->count * sizeof(int));
+    memcpy(pu->y, from->y, from->count * sizeof(int));
+    memcpy(pu->idle_since, from->idle_since, from->count * sizeof(int));
+    memcpy(pu->id, from->id, from->count * sizeof(unsigned int));
+    memcpy(pu->units, from->units, from->count * sizeof(int));
+    memcpy(pu->type, from->type, from->count * sizeof(char));
+    unit_index_copy(&pu->cells, &from->cells, capacity, cells);
+}
+
+/**
+ * Unit number i of the game, NULL for `NO_UNIT`.
+ */
+static unit* unit_number(player_units *pu, int i) {
+    return i == NO_UNIT ? NULL : &pu->base[i];
+}
+
+/**
+ * Puts unit u into the bucket of (x, y).
+ */
+static void link_cell(player_units *pu, unit *u, int x, int y) {
+    int first = unit_index_find(&pu->cells, cell_of(x), cell_of(y));
+    u->cell_prev = NO_UNIT;
+    u->cell_next = first;
+    if (first != NO_UNIT) {
+        pu->base[first].cell_prev = (int) (u - pu->base);
+    }
+    unit_index_insert(&pu->cells, cell_of(x), cell_of(y), (int) (u - pu->base));
+}
+
+/**
+ * Takes unit u out of the bucket of (x, y).
+ */
+static void unlink_cell(player_units *pu, unit *u, int x, int y) {
+    if (u->cell_prev != NO_UNIT) {
+        pu->base[u->cell_prev].cell_next = u->cell_next;
+    } else if (u->cell_next != NO_UNIT) {
+        unit_index_insert(&pu->cells, cell_of(x), cell_of(y), u->cell_next);
+    } else {
+        unit_index_remove(&pu->cells, cell_of(x), cell_of(y));
+    }
+    if (u->cell_next != NO_UNIT) {
+        pu->base[u->cell_next].cell_prev = u->cell_prev;
+    }
+}
+
+/**
+ * Puts unit u back into the bucket of (x, y) between the neighbours it had there, reverting `unlink_cell`.
+ * Units linked or unlinked there later have to be reverted first.
+ */
+static void relink_cell(player_units *pu, unit *u, int x, int y) {
+    int number = (int) (u - pu->base);
+    if (u->cell_prev != NO_UNIT) {
+        pu->base[u->cell_prev].cell_next = number;
+    } else {
+        unit_index_insert(&pu->cells, cell_of(x), cell_of(y), number);
+    }
+    if (u->cell_next != NO_UNIT) {
+        pu->base[u->cell_next].cell_prev = number;
+    }
+}
+
+void player_units_add(player_units *pu, unit *u) {
+    assert(pu->count < pu->capacity);
+
+    u->slot = pu->count++;
+    pu->x[u->slot] = u->x;
+    pu->y[u->slot] = u->y;
+    pu->type[u->slot] = u->type;
+    pu->idle_since[u->slot] = u->idle_since;
+    pu->id[u->slot] = u->id;
+    pu->units[u->slot] = (int) (u - pu->base);
+    link_cell(pu, u, u->x, u->y);
+}
+
+void player_units_remove(player_units *pu, unit *u) {
+    unsigned int slot = u->slot;
+    unsigned int last = --pu->count;
+
+    unlink_cell(pu, u, pu->x[slot], pu->y[slot]);
+
+    if (slot != last) {
+        pu->x[slot] = pu->x[last];
+        pu->y[slot] = pu->y[last];
+        pu->type[slot] = pu->type[last];
+        pu->idle_since[slot] = pu->idle_since[last];
+        pu->id[slot] = pu->id[last];
+        pu->units[slot] = pu->units[last];
+        pu->base[pu->units[slot]].slot = slot;
+    }
+}
+
+void player_units_restore(player_units *pu, unit *u) {
+    unsigned int slot = u->slot;
+    unsigned int last = pu->count++;
+
+    if (slot != last) { // the unit which took over the slot goes back to the end
+        pu->x[last] = pu->x[slot];
+        pu->y[last] = pu->y[slot];
+        pu->type[last] = pu->type[slot];
+        pu->idle_since[last] = pu->idle_since[slot];
+        pu->id[last] = pu->id[slot];
+        pu->units[last] = pu->units[slot];
+        pu->base[pu->units[last]].slot = last;
+    }
+
+    pu->x[slot] = u->x;
+    pu->y[slot] = u->y;
+    pu->type[slot] = u->type;
+    pu->idle_since[slot] = u->idle_since;
+    pu->id[slot] = u->id;
+    pu->units[slot] = (int) (u - pu->base);
+    relink_cell(pu, u, u->x, u->y); // its links are left as they were by the removal
+}
+
+void player_units_update(player_units *pu, unit *u) {
+    int old_x = pu->x[u->slot];
+    int old_y = pu->y[u->slot];
+    if (cell_of(old_x) != cell_of(u->x) || cell_of(old_y) != cell_of(u->y)) {
+        unlink_cell(pu, u, old_x, old_y);
+        link_cell(pu, u, u->x, u->y);
+    }
+
+    pu->x[u->slot] = u->x;
+    pu->y[u->slot] = u->y;
+    pu->idle_since[u->slot] = u->idle_since;
+}
+
+void player_units_revert_update(player_units *pu, unit *u, int cell_prev, int cell_next) {
+    int new_x = pu->x[u->slot];
+    int new_y = pu->y[u->slot];
+    if (cell_of(new_x) != cell_of(u->x) || cell_of(new_y) != cell_of(u->y)) {
+        unlink_cell(pu, u, new_x, new_y); // the update put it first in the bucket
+        u->cell_prev = cell_prev;
+        u->cell_next = cell_next;
+        relink_cell(pu, u, u->x, u->y);
+    }
+
+    pu->x[u->slot] = u->x;
+    pu->y[u->slot] = u->y;
+    pu->idle_since[u->slot] = u->idle_since;
+}
+
+unit* player_units_closest_linear(player_units *pu, int x, int y) {
+    unsigned int i;
+
+    if (pu->count == 0) {
+        return NULL;
+    }
+
+    // the smallest distance, the newest unit at that distance and its slot
+    int min_dist = min_distance(pu->x, pu->y, pu->count, x, y);
+    unsigned int newest = max_id_at_distance(pu->x, pu->y, pu->id, pu->count, x, y, min_dist);
+    for (i = 0; pu->id[i] != newest; i++) {
+    }
+
+    return &pu->base[pu->units[i]];
+}
+
+/**
+ * Distance in an infinity norm between (x1,y1) and (x2,y2).
+ */
+static int distance(int x1, int y1, int x2, int y2) {
+    int dx = abs(x1 - x2);
+    int dy = abs(y1 - y2);
+    return dx > dy ? dx : dy;
+}
+
+/**
+ * Checks units of bucket (cx, cy) against the best unit found so far.
+ */
+static void scan_cell(player_units *pu, int cx, int cy, int x, int y, unit **best, int *best_dist) {
+    if (cx < 1 || cy < 1 || cx > pu->cells.size || cy > pu->cells.size) {
+        return;
+    }
+
+    unit *u = unit_number(pu, unit_index_find(&pu->cells, cx, cy));
+    while (u != NULL) {
+        int dist = distance(x, y, u->x, u->y);
+        if (dist < *best_dist || (dist == *best_dist && u->id > (*best)->id)) {
+            *best_dist = dist;
+            *best = u;
+        }
+        u = unit_number(pu, u->cell_next);
+    }
+}
+
+unit* player_units_closest(player_units *pu, int x, int y) {
+    int cx = cell_of(x);
+    int cy = cell_of(y);
+    int ncells = pu->cells.size;
+    int best_dist = INT_MAX;
+    unit *best = NULL;
+    unsigned long long budget = pu->count / 32 + 9; // buckets worth visiting before a plain scan is cheaper
+    int r, i;
+
+    if (pu->count == 0) {
+        return NULL;
+    }
+
+    for (r = 0; ; r++) {
+        // every unit in ring r or further is at least this far
+        if (r > 0 && (long long) (r - 1) * CELL_SIZE + 1 > best_dist) {
+            return best;
+        }
+        if (cx - r < 1 && cy - r < 1 && cx + r > ncells && cy + r > ncells) {
+            return best; // rings cover the whole board
+        }
+        if ((unsigned long long) (2 * r + 1) * (2 * r + 1) > budget) {
+            return player_units_closest_linear(pu, x, y);
+        }
+
+        if (r == 0) {
+            scan_cell(pu, cx, cy, x, y, &best, &best_dist);
+            continue;
+        }
+        for (i = -r; i <= r; i++) {
+            scan_cell(pu, cx + i, cy - r, x, y, &best, &best_dist); // top and bottom rows
+            scan_cell(pu, cx + i, cy + r, x, y, &best, &best_dist);
+        }
+        for (i = -r + 1; i <= r - 1; i++) {
+            scan_cell(pu, cx - r, cy + i, x, y, &best, &best_dist); // left and right columns
+            scan_cell(pu, cx + r, cy + i, x, y, &best, &best_dist);
+        }
+    }
+}
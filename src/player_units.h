@@ -0,0 +1,107 @@
+ /** @file
+    Interface of units of a single player stored as a structure of arrays.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef PLAYER_UNITS_H
+#define PLAYER_UNITS_H
+
+#include "unit_index.h"
+
+/**
+ * Side of a square bucket of the spatial index.
+ */
+#define CELL_SIZE 16
+
+struct def_unit;
+
+/**
+ * Copies of the fields of all units of one player, kept in separate contiguous arrays,
+ * so that scans over them are tight loops the compiler can vectorize.
+ * Slot i describes unit base[units[i]]; the unit knows its slot. Order of slots is arbitrary.
+ *
+ * Units are also put into CELL_SIZE x CELL_SIZE buckets, so that the closest unit
+ * can be found by looking only at buckets around the query point.
+ *
+ * Units are referred to by their numbers in the array base of all units of the game, and all arrays
+ * live in memory given by the owner, so the whole structure can be copied together with the units.
+ */
+typedef struct def_player_units {
+    unit_index cells;             // bucket (cx, cy) to the first unit in it, units linked by cell_next
+    int *x;
+    int *y;
+    char *type;
+    int *idle_since;
+    unsigned int *id;             // order of creation of units, newer units have bigger ids
+    int *units;                   // numbers of units
+    struct def_unit *base;        // all units of the game
+    unsigned int count;
+    unsigned int capacity;
+} player_units;
+
+/**
+ * Number of bytes of memory for up to capacity units on a board of size n, a multiple of 8.
+ */
+size_t player_units_bytes(int n, unsigned int capacity);
+
+/**
+ * Prepares an empty set of up to capacity units of array base on a board of size n,
+ * in memory of `player_units_bytes(n, capacity)` bytes.
+ */
+void player_units_init(player_units *pu, int n, unsigned int capacity, struct def_unit *base, void *memory);
+
+/**
+ * Points the structure to base and memory, holding copies of its units and arrays.
+ */
+void player_units_bind(player_units *pu, struct def_unit *base, void *memory);
+
+/**
+ * Makes pu a copy of from for up to capacity units of array base, in memory of `player_units_bytes` bytes.
+ */
+void player_units_copy(player_units *pu, const player_units *from, unsigned int capacity,
+                       struct def_unit *base, void *memory);
+
+/**
+ * Adds unit u, storing its slot in it.
+ */
+void player_units_add(player_units *pu, struct def_unit *u);
+
+/**
+ * Removes unit u. The last unit takes over its slot.
+ */
+void player_units_remove(player_units *pu, struct def_unit *u);
+
+/**
+ * Reverts `player_units_remove` of unit u, putting it back into its old slot and its old place
+ * in the bucket. Units removed later have to be restored first.
+ */
+void player_units_restore(player_units *pu, struct def_unit *u);
+
+/**
+ * Copies current position and idle_since of unit u into the arrays.
+ */
+void player_units_update(player_units *pu, struct def_unit *u);
+
+/**
+ * Reverts `player_units_update` of unit u, whose position and idle_since are back to the old ones.
+ * cell_prev and cell_next are its links in the bucket of the old position before the update.
+ * Units updated later have to be reverted first.
+ */
+void player_units_revert_update(player_units *pu, struct def_unit *u, int cell_prev, int cell_next);
+
+/**
+ * Returns unit closest to (x, y) in an infinity norm, or NULL if there are no units.
+ * Among equally distant units the newest one is chosen.
+ * Searches buckets in growing rings around (x, y) and falls back to a scan of
+ * all units when the rings would cover more buckets than there are units.
+ */
+struct def_unit* player_units_closest(player_units *pu, int x, int y);
+
+/**
+ * Same as player_units_closest, but always scans all units.
+ */
+struct def_unit* player_units_closest_linear(player_units *pu, int x, int y);
+
+#endif /* PLAYER_UNITS_H */
@@ -9,25 +9,186 @@
     @date 2016-08-26
  */
 
+#include <errno.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "print.h"
 
-void print_end_turn_command() {
-	printf("END_TURN\n");
-	fflush(stdout);
+#define MAX_LINE_LENGTH 128
+
+void output_init(output *out, const char *prefix) {
+	out->data = NULL;
+	out->length = 0;
+	out->capacity = 0;
+	snprintf(out->prefix, sizeof(out->prefix), "%s", prefix);
+	out->discard = false;
+	out->fd = -1;
+	out->flush_lines = false;
+	out->binary = false;
+}
+
+void output_init_discarding(output *out) {
+	output_init(out, "");
+	out->discard = true;
+}
+
+void output_init_writing(output *out, int fd, bool flush_lines, bool binary) {
+	output_init(out, "");
+	out->fd = fd;
+	out->flush_lines = flush_lines;
+	out->binary = binary;
+}
+
+void output_free(output *out) {
+	free(out->data);
+	out->data = NULL;
+	out->length = 0;
+	out->capacity = 0;
+}
+
+void output_flush(output *out, FILE *stream) {
+	if (out->length > 0) {
+		fwrite(out->data, 1, out->length, stream);
+		fflush(stream);
+		out->length = 0;
+	}
+}
+
+void output_write(output *out) {
+	size_t written = 0;
+	ssize_t bytes;
+
+	while (written < out->length) {
+		bytes = write(out->fd, out->data + written, out->length - written);
+		if (bytes < 0 && errno == EINTR) {
+			continue;
+		}
+		if (bytes <= 0) {
+			break; // nobody reads the output anymore
+		}
+		written += (size_t) bytes;
+	}
+	out->length = 0;
+}
+
+/**
+ * Makes room for `bytes` more bytes in the buffer.
+ */
+static void reserve(output *out, size_t bytes) {
+	if (out->length + bytes > out->capacity) {
+		out->capacity = 2 * out->capacity + bytes;
+		out->data = realloc(out->data, out->capacity);
+	}
 }
 
-void print_move_command(int x1, int y1, int x2, int y2) {
-	printf("MOVE %d %d %d %d\n", x1, y1, x2, y2);
- 	fflush(stdout);
+/**
+ * Prints a command as a record of the binary protocol.
+ */
+static void print_record(output *out, const command *printed) {
+	if (out->discard) {
+		return;
+	}
+
+	reserve(out, COMMAND_RECORD_SIZE);
+	encode_command(printed, (unsigned char *) out->data + out->length);
+	out->length += COMMAND_RECORD_SIZE;
+	if (out->flush_lines) {
+		output_write(out);
+	}
+}
+
+void print_line(output *out, const char *format, ...) {
+	va_list args;
+
+	if (out != NULL && out->discard) {
+		return;
+	}
+
+	va_start(args, format);
+	if (out == NULL) {
+		vprintf(format, args);
+		fflush(stdout);
+	} else {
+		reserve(out, sizeof(out->prefix) + MAX_LINE_LENGTH);
+
+		size_t prefix_length = strlen(out->prefix);
+		memcpy(out->data + out->length, out->prefix, prefix_length);
+		out->length += prefix_length;
+		out->length += vsnprintf(out->data + out->length, MAX_LINE_LENGTH, format, args);
+		if (out->flush_lines) {
+			output_write(out);
+		}
+	}
+
+	va_end(args);
 }
 
-void print_produce_peasant_command(int x1, int y1, int x2, int y2) {
-	printf("PRODUCE_PEASANT %d %d %d %d\n", x1, y1, x2, y2);
-	fflush(stdout);
+void print_end_turn_command(output *out) {
+	if (out != NULL && out->binary) {
+		command printed = {OPCODE_END_TURN, {0}};
+		print_record(out, &printed);
+	} else {
+		print_line(out, "END_TURN\n");
+	}
+	if (out != NULL && out->fd >= 0) {
+		output_write(out); // the whole turn in a single write
+	}
 }
 
-void print_produce_knight_command(int x1, int y1, int x2, int y2) {
-	printf("PRODUCE_KNIGHT %d %d %d %d\n", x1, y1, x2, y2);
-	fflush(stdout);
+void print_move_command(output *out, int x1, int y1, int x2, int y2) {
+	if (out != NULL && out->binary) {
+		command printed = {OPCODE_MOVE, {x1, y1, x2, y2}};
+		print_record(out, &printed);
+	} else {
+		print_line(out, "MOVE %d %d %d %d\n", x1, y1, x2, y2);
+	}
+}
+
+void print_produce_peasant_command(output *out, int x1, int y1, int x2, int y2) {
+	if (out != NULL && out->binary) {
+		command printed = {OPCODE_PRODUCE_PEASANT, {x1, y1, x2, y2}};
+		print_record(out, &printed);
+	} else {
+		print_line(out, "PRODUCE_PEASANT %d %d %d %d\n", x1, y1, x2, y2);
+	}
+}
+
+void print_produce_knight_command(output *out, int x1, int y1, int x2, int y2) {
+	if (out != NULL && out->binary) {
+		command printed = {OPCODE_PRODUCE_KNIGHT, {x1, y1, x2, y2}};
+		print_record(out, &printed);
+	} else {
+		print_line(out, "PRODUCE_KNIGHT %d %d %d %d\n", x1, y1, x2, y2);
+	}
+}
+
+void print_command(output *out, const command *printed) {
+	const int *d = printed->data;
+
+	switch (printed->opcode) {
+		case OPCODE_INIT:
+			if (out != NULL && out->binary) {
+				print_record(out, printed);
+			} else {
+				print_line(out, "INIT %d %d %d %d %d %d %d\n", d[0], d[1], d[2], d[3], d[4], d[5], d[6]);
+			}
+			break;
+		case OPCODE_MOVE:
+			print_move_command(out, d[0], d[1], d[2], d[3]);
+			break;
+		case OPCODE_PRODUCE_KNIGHT:
+			print_produce_knight_command(out, d[0], d[1], d[2], d[3]);
+			break;
+		case OPCODE_PRODUCE_PEASANT:
+			print_produce_peasant_command(out, d[0], d[1], d[2], d[3]);
+			break;
+		case OPCODE_END_TURN:
+			print_end_turn_command(out);
+			break;
+		default:
+			break; // an incorrect command has nothing to print
+	}
 }
@@ -9,23 +9,87 @@
     @date 2016-08-26
  */
 
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "parse.h"
+
+/**
+ * Buffer collecting printed commands instead of writing them to stdout.
+ */
+typedef struct def_output {
+	char *data;
+	size_t length;
+	size_t capacity;
+	char prefix[16];      // written before every line, e.g. "G17 "
+	bool discard;         // lines are dropped, as in games only simulated by AI
+	int fd;               // written to at every END_TURN, -1 when the owner flushes the buffer
+	bool flush_lines;     // written to fd after every line instead
+	bool binary;          // commands are printed as binary records instead of lines
+} output;
+
+/**
+ * Prepares an empty buffer putting prefix before every line.
+ */
+void output_init(output *out, const char *prefix);
+
+/**
+ * Prepares a buffer dropping everything printed to it.
+ */
+void output_init_discarding(output *out);
+
+/**
+ * Prepares an empty buffer writing itself to the file descriptor fd: the whole turn at once
+ * when END_TURN is printed, or every line as soon as it is printed if flush_lines.
+ * With binary, commands are printed as records of the binary protocol.
+ */
+void output_init_writing(output *out, int fd, bool flush_lines, bool binary);
+
+/**
+ * Frees memory of the buffer.
+ */
+void output_free(output *out);
+
+/**
+ * Writes contents of the buffer to stream and empties it.
+ */
+void output_flush(output *out, FILE *stream);
+
+/**
+ * Writes contents of the buffer to its file descriptor and empties it.
+ */
+void output_write(output *out);
+
+/**
+ * Prints a line formatted as in printf. With out == NULL prints to stdout and flushes it.
+ */
+void print_line(output *out, const char *format, ...);
+
 /**
  * Prints the END_TURN command.
  */
-void print_end_turn_command();
+void print_end_turn_command(output *out);
 
 /**
  * Prints the MOVE command.
  */
- void print_move_command(int x1, int x2, int y1, int y2);
+ void print_move_command(output *out, int x1, int x2, int y1, int y2);
 
 /**
  * Prints the PRODUCE_PEASANT command.
  */
- void print_produce_peasant_command(int x1, int x2, int y1, int y2);
+ void print_produce_peasant_command(output *out, int x1, int x2, int y1, int y2);
 
 /**
  * Prints the PRODUCE_KNIGHT command.
  */
- void print_produce_knight_command(int x1, int x2, int y1, int y2);
+ void print_produce_knight_command(output *out, int x1, int x2, int y1, int y2);
+
+/**
+ * Prints a parsed command, INIT included, as the printer of its kind does.
+ */
+void print_command(output *out, const command *printed);
 
+#endif /* PRINT_H */
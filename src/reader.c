@@ -0,0 +1,39 @@
+ /** @file
+    Reading commands on a separate thread.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <stdbool.h>
+#include <unistd.h>
+#include "reader.h"
+
+static void* read_commands(void *arg) {
+    reader *r = (reader *) arg;
+    bool correct = true;
+
+    while (correct) {
+        command *new_command = command_queue_reserve(&r->queue);
+        correct = command_stream_next(&r->input, new_command) == 0;
+        if (!correct) {
+            new_command->opcode = OPCODE_WRONG; // the game ends with RESULT_WRONG_COMMAND
+        }
+        command_queue_push(&r->queue);
+    }
+
+    return NULL;
+}
+
+int reader_start(reader *r, bool binary) {
+    int error;
+
+    command_queue_init(&r->queue);
+    command_stream_init(&r->input, STDIN_FILENO, binary);
+    command_stream_handshake(&r->input); // an arbiter may send it to an AI started with -binary as well
+    error = pthread_create(&r->thread, NULL, read_commands, r);
+    if (error == 0) {
+        pthread_detach(r->thread); // never joined, it may be waiting for input when the game ends
+    }
+    return error;
+}
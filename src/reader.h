@@ -0,0 +1,36 @@
+ /** @file
+    Interface of reading commands on a separate thread.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef READER_H
+#define READER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include "command_queue.h"
+
+/**
+ * Thread reading and parsing commands from stdin, while the engine executes earlier ones.
+ */
+typedef struct def_reader {
+    command_queue queue;          // commands read, in order
+    command_stream input;         // stdin, read by the thread only
+    pthread_t thread;
+} reader;
+
+/**
+ * Starts a thread putting commands read from stdin into the queue of r. The first incorrect
+ * line, or the end of input, is passed on as a command with `OPCODE_WRONG`, after which
+ * the thread stops. Nothing is read after it, so it can be executed as any other command
+ * to end the game with `RESULT_WRONG_COMMAND` at the right moment.
+ * Commands are read as binary records if binary, or if the first line is `BINARY_HANDSHAKE`,
+ * which is waited for before the thread starts and dropped in both cases;
+ * r->input.binary tells which protocol is used.
+ * @return 0 on success, an error number if the thread cannot be started.
+ */
+int reader_start(reader *r, bool binary);
+
+#endif /* READER_H */
@@ -0,0 +1,806 @@
+ /** @file
+    Alpha-beta search over whole turns of both players.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "search.h"
+
+#define MIN(a, b) (((a)<(b))?(a):(b))
+#define MAX(a, b) (((a)>(b))?(a):(b))
+
+#define MAX_DEPTH 32              // in turns
+#define WIN_SCORE 1000000         // score of a won game, reduced by the number of turns to the win
+#define INFINITE_SCORE (WIN_SCORE + 1)
+#define CERTAIN_SCORE (WIN_SCORE - 2 * MAX_DEPTH) // scores beyond it count turns to the end of the game
+#define INITIAL_CAPACITY 256
+
+#define KNIGHT_VALUE 30
+#define PEASANT_VALUE 60          // a peasant produces a knight every third round
+#define SPARE_PEASANT_VALUE 10    // for peasants beyond the first WORKING_PEASANTS ones
+#define WORKING_PEASANTS 3        // peasants produce peasants until there are this many of them, then knights
+#define READY_PEASANT 30          // for a peasant able to produce, in thirds for every round of waiting
+#define KING_THREAT 100           // for a knight next to the enemy king, half of it two fields away
+#define NEAR_KING 16              // for a knight next to the enemy king, falling to 0 at the distance of the board size
+#define GUARD_RADIUS 4            // guarding knights go for enemy units at most this far from their king
+#define FLEE_RADIUS 3             // a fleeing king runs from enemy units at most this far
+
+enum KnightStance {
+    CHARGE_CLOSEST,               // towards the closest enemy unit, like the greedy AI
+    CHARGE_KING,                  // towards the enemy king
+    GUARD_KING                    // towards enemy units near the own king, otherwise as CHARGE_CLOSEST
+};
+
+enum KingStance {
+    KING_STAYS,
+    KING_FLEES                    // away from close enemy units, preferring fields with more room around
+};
+
+/**
+ * Policy generating one candidate turn. Knights take an adjacent king, then an adjacent peasant,
+ * before following the stance; peasants always produce when they can.
+ */
+typedef struct def_stance {
+    enum KnightStance knights;
+    enum KingStance king;
+} stance;
+
+#define STANCES CANDIDATE_TURNS
+
+static const stance stances[STANCES] = {
+    {CHARGE_CLOSEST, KING_STAYS},
+    {CHARGE_CLOSEST, KING_FLEES},
+    {CHARGE_KING, KING_STAYS},
+    {CHARGE_KING, KING_FLEES},
+    {GUARD_KING, KING_STAYS},
+    {GUARD_KING, KING_FLEES}
+};
+
+/**
+ * Candidate turn: actions[start..start+length) of the search.
+ */
+typedef struct def_plan {
+    size_t start;
+    size_t length;
+    int order;                    // gain of its captures, better turns are tried first
+} plan;
+
+typedef struct def_search {
+    board *game;
+    int player;                   // player the search is maximizing for
+    const turn_limit *limit;      // NULL when only candidates are generated
+    transposition_table *tt;      // NULL when positions are not remembered
+    bool aborted;                 // time is over, results of the current iteration are void
+    bool cut_by_depth;            // some line of the current iteration was cut by depth, not by the end of the game
+    action *actions;              // plans of all nodes on the current path, each node uses a range above its parent's
+    size_t count;
+    size_t capacity;
+    unit **units;                 // units of the plan being built, in order of acting
+    size_t units_capacity;
+} search;
+
+/**
+ * State of building a single plan.
+ */
+typedef struct def_planner {
+    search *s;
+    int p;                        // player whose turn is built
+    stance st;
+    unit *own_king;
+    unit *enemy_king;
+    int peasants;                 // number of peasants of p
+    int order;
+    int made;                     // actions made on the board
+    bool over;                    // the game has ended
+} planner;
+
+long long monotonic_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+bool limit_reached(const turn_limit *limit) {
+    if (limit->cancelled != NULL && __atomic_load_n(limit->cancelled, __ATOMIC_RELAXED) != CANCEL_NONE) {
+        int raised = CANCEL_RAISED;
+        __atomic_compare_exchange_n(limit->cancelled, &raised, CANCEL_TAKEN, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        return true;
+    }
+    return monotonic_ns() > limit->deadline;
+}
+
+void turn_free(turn *t) {
+    free(t->actions);
+    t->actions = NULL;
+    t->count = 0;
+    t->capacity = 0;
+}
+
+static int distance(int x1, int y1, int x2, int y2) {
+    return MAX(abs(x1-x2), abs(y1-y2));
+}
+
+/**
+ * Type of unit u in lowercase.
+ */
+static char simple_type(unit *u) {
+    return u->type + 32 * (u->type <= 90);
+}
+
+static int owner(unit *u) {
+    return u->type <= 90 ? 1 : 2;
+}
+
+static int value(unit *u) {
+    switch (simple_type(u)) {
+        case 'r' :
+            return KNIGHT_VALUE;
+        case 'c' :
+            return PEASANT_VALUE;
+        default :
+            return 0;
+    }
+}
+
+static unit* find_king(board *game, int p) {
+    unit *u = game_units(game, p);
+    while (u != NULL && simple_type(u) != 'k') {
+        u = game_next_unit(game, u);
+    }
+    return u;
+}
+
+static bool on_board(board *game, int x, int y) {
+    return MIN(x, y) >= 1 && MAX(x, y) <= game_size(game);
+}
+
+/**
+ * Checks if unit u stands next to a knight of the other player.
+ */
+static bool attacked(board *game, unit *u) {
+    int dx, dy;
+    for (dx = -1; dx <= 1; dx++) {
+        for (dy = -1; dy <= 1; dy++) {
+            unit *neighbour = game_unit_at(game, u->x + dx, u->y + dy);
+            if (neighbour != NULL && simple_type(neighbour) == 'r' && owner(neighbour) != owner(u)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Score of a position from the point of view of the searching player:
+ * value of units, readiness of peasants, closeness of knights to the enemy king and threats to kings and peasants.
+ * A peasant next to an enemy knight counts as lost, or as half lost when its player is to move.
+ * A knight next to the enemy king which can still act in the current turn counts as a won game.
+ */
+static int evaluate(search *s) {
+    board *game = s->game;
+    int turn = game_turn(game);
+    int size = game_size(game);
+    int score = 0;
+    int p;
+
+    for (p = 1; p <= 2; p++) {
+        unit *enemy_king = find_king(game, 3 - p);
+        int points = 0;
+        int peasants = 0;
+        unit *u;
+
+        for (u = game_units(game, p); u != NULL; u = game_next_unit(game, u)) {
+            int idle = game_idle_rounds(game, u);
+            if (simple_type(u) == 'c') {
+                points += ++peasants <= WORKING_PEASANTS ? PEASANT_VALUE : SPARE_PEASANT_VALUE;
+                points += READY_PEASANT * MIN(idle + 1, 3) / 3; // idle is -1 right after acting
+                if (attacked(game, u)) {
+                    points -= p == turn ? PEASANT_VALUE / 2 : PEASANT_VALUE;
+                }
+            } else if (simple_type(u) == 'r') {
+                points += KNIGHT_VALUE;
+                if (enemy_king != NULL) {
+                    int d = distance(u->x, u->y, enemy_king->x, enemy_king->y);
+                    if (d == 1 && p == turn && idle != -1) {
+                        return p == s->player ? WIN_SCORE / 2 : -WIN_SCORE / 2;
+                    }
+                    points += (int) ((long long) NEAR_KING * (size - d) / size);
+                    if (d <= 2) {
+                        points += KING_THREAT / d;
+                    }
+                }
+            }
+        }
+
+        score += p == s->player ? points : -points;
+    }
+
+    return score;
+}
+
+/**
+ * Change of material for the player making the move when unit mover attacks unit target,
+ * following the rules of `fight`.
+ */
+static int exchange(unit *mover, unit *target) {
+    char attacker = simple_type(mover);
+    char defender = simple_type(target);
+
+    if (attacker == defender) {
+        return 0;
+    } else if (attacker == 'c') {
+        return -value(mover);
+    } else if (defender == 'c') {
+        return value(target);
+    } else if (attacker == 'r') {
+        return WIN_SCORE;             // knight takes king
+    } else {
+        return -WIN_SCORE;            // king walks into a knight
+    }
+}
+
+static int make_action(board *game, const action *a) {
+    switch (a->kind) {
+        case ACTION_MOVE :
+            return game_make_move(game, a->x1, a->y1, a->x2, a->y2);
+        case ACTION_PRODUCE_KNIGHT :
+            return game_make_produce_knight(game, a->x1, a->y1, a->x2, a->y2);
+        default :
+            return game_make_produce_peasant(game, a->x1, a->y1, a->x2, a->y2);
+    }
+}
+
+/**
+ * Appends action of unit u to the plan being built and makes it.
+ */
+static void record(planner *pn, unit *u, enum ActionKind kind, int x2, int y2) {
+    search *s = pn->s;
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity == 0 ? INITIAL_CAPACITY : 2 * s->capacity;
+        s->actions = realloc(s->actions, s->capacity * sizeof(action));
+    }
+
+    action *a = &s->actions[s->count++];
+    a->kind = kind;
+    a->x1 = u->x;
+    a->y1 = u->y;
+    a->x2 = x2;
+    a->y2 = y2;
+
+    unit *target = game_unit_at(s->game, x2, y2);
+    if (target != NULL) {
+        pn->order = MIN(pn->order + exchange(u, target), WIN_SCORE);
+    }
+
+    int result = make_action(s->game, a);
+    assert(result != RESULT_WRONG_COMMAND);
+    pn->made++;
+    pn->over = result != RESULT_ONGOING;
+}
+
+/**
+ * Moves unit u to a neighbouring field closer to (x, y), if there is one.
+ */
+static void step_towards(planner *pn, unit *u, int x, int y) {
+    board *game = pn->s->game;
+    int best_distance = distance(u->x, u->y, x, y);
+    int best_x = 0;
+    int best_y = 0;
+    int dx, dy;
+
+    for (dx = -1; dx <= 1; dx++) {
+        for (dy = -1; dy <= 1; dy++) {
+            int x2 = u->x + dx;
+            int y2 = u->y + dy;
+            unit *occupant = game_unit_at(game, x2, y2);
+            if (!on_board(game, x2, y2) || (occupant != NULL && owner(occupant) == pn->p)) {
+                continue;
+            }
+
+            int d = distance(x2, y2, x, y);
+            if (d < best_distance) {
+                best_distance = d;
+                best_x = x2;
+                best_y = y2;
+            }
+        }
+    }
+
+    if (best_x != 0) {
+        record(pn, u, ACTION_MOVE, best_x, best_y);
+    }
+}
+
+static void knight_acts(planner *pn, unit *knight) {
+    board *game = pn->s->game;
+    int enemy = 3 - pn->p;
+    unit *prey = NULL;
+    unit *target = NULL;
+    int dx, dy;
+
+    for (dx = -1; dx <= 1; dx++) {
+        for (dy = -1; dy <= 1; dy++) {
+            unit *neighbour = game_unit_at(game, knight->x + dx, knight->y + dy);
+            if (neighbour == NULL || owner(neighbour) != enemy) {
+                continue;
+            }
+            if (simple_type(neighbour) == 'k' || (simple_type(neighbour) == 'c' && prey == NULL)) {
+                prey = neighbour; // a king is taken before any peasant
+            }
+        }
+    }
+    if (prey != NULL) {
+        record(pn, knight, ACTION_MOVE, prey->x, prey->y);
+        return;
+    }
+
+    if (pn->st.knights == CHARGE_KING) {
+        target = pn->enemy_king;
+    } else if (pn->st.knights == GUARD_KING && pn->own_king != NULL) {
+        unit *threat = game_closest_unit(game, enemy, pn->own_king->x, pn->own_king->y);
+        if (threat != NULL &&
+            distance(threat->x, threat->y, pn->own_king->x, pn->own_king->y) <= GUARD_RADIUS) {
+            target = threat;
+        }
+    }
+    if (target == NULL) {
+        target = game_closest_unit(game, enemy, knight->x, knight->y);
+    }
+
+    if (target != NULL) {
+        step_towards(pn, knight, target->x, target->y);
+    }
+}
+
+/**
+ * Safety of (x, y) for the king of player p: distance to the closest enemy unit first,
+ * then the number of fields of the board around it.
+ */
+static int king_safety(board *game, int p, int x, int y) {
+    unit *threat = game_closest_unit(game, 3 - p, x, y);
+    int size = game_size(game);
+    int room = (MIN(x + 1, size) - MAX(x - 1, 1) + 1) * (MIN(y + 1, size) - MAX(y - 1, 1) + 1);
+    int d = threat == NULL ? FLEE_RADIUS + 1 : MIN(distance(x, y, threat->x, threat->y), FLEE_RADIUS + 1);
+    return 16 * d + room;
+}
+
+static void king_acts(planner *pn, unit *king) {
+    board *game = pn->s->game;
+    unit *threat = game_closest_unit(game, 3 - pn->p, king->x, king->y);
+    int dx, dy;
+
+    if (pn->st.king == KING_STAYS || threat == NULL ||
+        distance(king->x, king->y, threat->x, threat->y) > FLEE_RADIUS) {
+        return;
+    }
+
+    int best_safety = king_safety(game, pn->p, king->x, king->y);
+    int best_x = 0;
+    int best_y = 0;
+    for (dx = -1; dx <= 1; dx++) {
+        for (dy = -1; dy <= 1; dy++) {
+            int x2 = king->x + dx;
+            int y2 = king->y + dy;
+            if (!on_board(game, x2, y2) || game_unit_at(game, x2, y2) != NULL) {
+                continue;
+            }
+
+            int safety = king_safety(game, pn->p, x2, y2);
+            if (safety > best_safety) {
+                best_safety = safety;
+                best_x = x2;
+                best_y = y2;
+            }
+        }
+    }
+
+    if (best_x != 0) {
+        record(pn, king, ACTION_MOVE, best_x, best_y);
+    }
+}
+
+static void unit_acts(planner *pn, unit *u);
+
+/**
+ * A ready peasant produces peasants until there are WORKING_PEASANTS of them, then knights,
+ * on the free neighbouring field closest to (for knights) or farthest from (for peasants) the enemy.
+ */
+static void peasant_acts(planner *pn, unit *peasant) {
+    board *game = pn->s->game;
+    bool knight = pn->peasants >= WORKING_PEASANTS;
+    unit *enemy = game_closest_unit(game, 3 - pn->p, peasant->x, peasant->y);
+    int best_x = 0;
+    int best_y = 0;
+    int best_score = 0;
+    int dx, dy;
+
+    if (game_idle_rounds(game, peasant) < 2 || enemy == NULL) {
+        return;
+    }
+
+    for (dx = -1; dx <= 1; dx++) {
+        for (dy = -1; dy <= 1; dy++) {
+            int x2 = peasant->x + dx;
+            int y2 = peasant->y + dy;
+            if (!on_board(game, x2, y2) || game_unit_at(game, x2, y2) != NULL) {
+                continue;
+            }
+
+            int d = distance(x2, y2, enemy->x, enemy->y);
+            int score = knight ? -d : d;
+            if (best_x == 0 || score > best_score) {
+                best_score = score;
+                best_x = x2;
+                best_y = y2;
+            }
+        }
+    }
+
+    if (best_x != 0) {
+        record(pn, peasant, knight ? ACTION_PRODUCE_KNIGHT : ACTION_PRODUCE_PEASANT, best_x, best_y);
+        pn->peasants += !knight;
+        if (!pn->over) {
+            unit_acts(pn, game_unit_at(game, best_x, best_y)); // a new unit acts right after it was produced
+        }
+    }
+}
+
+static void unit_acts(planner *pn, unit *u) {
+    switch (simple_type(u)) {
+        case 'r' :
+            knight_acts(pn, u);
+            break;
+        case 'k' :
+            king_acts(pn, u);
+            break;
+        default :
+            peasant_acts(pn, u);
+    }
+}
+
+/**
+ * Builds the turn of the player to move following stance st, leaving the board as it was.
+ */
+static void build_plan(search *s, stance st, plan *pl) {
+    board *game = s->game;
+    planner pn;
+    size_t count = 0;
+    size_t i;
+    unit *u;
+
+    pn.s = s;
+    pn.p = game_turn(game);
+    pn.st = st;
+    pn.own_king = find_king(game, pn.p);
+    pn.enemy_king = find_king(game, 3 - pn.p);
+    pn.peasants = 0;
+    pn.order = 0;
+    pn.made = 0;
+    pn.over = false;
+
+    // units act in order of the list, as with the greedy AI; the list itself changes while they act
+    for (u = game_units(game, pn.p); u != NULL; u = game_next_unit(game, u)) {
+        if (count == s->units_capacity) {
+            s->units_capacity = s->units_capacity == 0 ? INITIAL_CAPACITY : 2 * s->units_capacity;
+            s->units = realloc(s->units, s->units_capacity * sizeof(unit *));
+        }
+        s->units[count++] = u;
+        pn.peasants += simple_type(u) == 'c';
+    }
+
+    pl->start = s->count;
+    for (i = 0; i < count && !pn.over; i++) {
+        unit_acts(&pn, s->units[i]); // other units of the player always survive its action
+    }
+    pl->length = s->count - pl->start;
+    pl->order = pn.order;
+
+    while (pn.made-- > 0) {
+        game_unmake(game);
+    }
+}
+
+/**
+ * Puts distinct candidate turns of the player to move into plans, the most promising first,
+ * and returns their number.
+ */
+static int generate(search *s, plan *plans) {
+    int count = 0;
+    int i, j;
+
+    for (i = 0; i < STANCES; i++) {
+        if (i > 0 && s->limit != NULL && limit_reached(s->limit)) {
+            s->aborted = true; // building a plan of a big army takes a while, the rest would be void
+            break;
+        }
+
+        plan *pl = &plans[count];
+        build_plan(s, stances[i], pl);
+
+        for (j = 0; j < count; j++) {
+            if (plans[j].length == pl->length && (pl->length == 0 ||
+                memcmp(&s->actions[plans[j].start], &s->actions[pl->start], pl->length * sizeof(action)) == 0)) {
+                break;
+            }
+        }
+        if (j < count) {
+            s->count = pl->start; // the same turn as an earlier one
+        } else {
+            count++;
+        }
+    }
+
+    for (i = 1; i < count; i++) { // stable, so that equally good turns keep the order of stances
+        plan current = plans[i];
+        for (j = i; j > 0 && plans[j - 1].order < current.order; j--) {
+            plans[j] = plans[j - 1];
+        }
+        plans[j] = current;
+    }
+
+    return count;
+}
+
+static int alpha_beta(search *s, int depth, int ply, int alpha, int beta);
+
+/**
+ * Value of the position after turn pl, searched to the given depth.
+ */
+static int child(search *s, const plan *pl, int depth, int ply, int alpha, int beta) {
+    int result = RESULT_ONGOING;
+    int made = 0;
+    int score;
+    size_t i;
+
+    for (i = 0; i < pl->length && result == RESULT_ONGOING; i++) {
+        result = make_action(s->game, &s->actions[pl->start + i]);
+        made++;
+    }
+    if (result == RESULT_ONGOING) {
+        result = game_make_end_turn(s->game);
+        made++;
+    }
+
+    switch (result) {
+        case RESULT_ONGOING :
+            score = alpha_beta(s, depth - 1, ply + 1, alpha, beta);
+            break;
+        case RESULT_WIN :
+            score = WIN_SCORE - ply;
+            break;
+        case RESULT_LOSE :
+            score = -WIN_SCORE + ply;
+            break;
+        default :
+            score = 0;
+    }
+
+    while (made-- > 0) {
+        game_unmake(s->game);
+    }
+    return score;
+}
+
+/**
+ * Score to be kept in the transposition table: a number of turns to the end of the game
+ * is counted from the position, not from the root of the search.
+ */
+static int to_table(int score, int ply) {
+    return score >= CERTAIN_SCORE ? score + ply : score <= -CERTAIN_SCORE ? score - ply : score;
+}
+
+static int from_table(int score, int ply) {
+    return score >= CERTAIN_SCORE ? score - ply : score <= -CERTAIN_SCORE ? score + ply : score;
+}
+
+static int alpha_beta(search *s, int depth, int ply, int alpha, int beta) {
+    if (s->aborted || limit_reached(s->limit)) {
+        s->aborted = true;
+        return 0;
+    }
+    if (depth == 0) {
+        s->cut_by_depth = true;
+        return evaluate(s);
+    }
+
+    uint64_t key = game_hash(s->game);
+    tt_data known;
+    int first = 0;                // candidate turn tried first, the best one known from the table
+
+    if (s->tt != NULL && tt_probe(s->tt, key, &known)) {
+        if (known.depth >= depth) {
+            int score = from_table(known.score, ply);
+            if (known.depth != TT_DEPTH_FULL) {
+                s->cut_by_depth = true;
+            }
+            if (known.bound == BOUND_EXACT ||
+                (known.bound == BOUND_LOWER && score >= beta) ||
+                (known.bound == BOUND_UPPER && score <= alpha)) {
+                return score;
+            }
+        }
+        first = known.move;
+    }
+
+    size_t base = s->count;
+    plan plans[STANCES];
+    int count = generate(s, plans);
+    bool maximizing = game_turn(s->game) == s->player;
+    int best = maximizing ? -INFINITE_SCORE : INFINITE_SCORE;
+    int best_move = 0;
+    int original_alpha = alpha;
+    int original_beta = beta;
+    bool cut_before = s->cut_by_depth;
+    int i;
+
+    if (first >= count) {
+        first = 0;
+    }
+    s->cut_by_depth = false;
+    for (i = 0; i < count; i++) {
+        int k = i == 0 ? first : (i <= first ? i - 1 : i);
+        int score = child(s, &plans[k], depth, ply, alpha, beta);
+        if (s->aborted) {
+            break;
+        }
+
+        if (maximizing ? score > best : score < best) {
+            best = score;
+            best_move = k;
+        }
+        if (maximizing) {
+            alpha = MAX(alpha, score);
+        } else {
+            beta = MIN(beta, score);
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    if (s->tt != NULL && !s->aborted) {
+        tt_data result;
+        result.score = to_table(best, ply);
+        result.depth = s->cut_by_depth ? depth : TT_DEPTH_FULL;
+        result.bound = best <= original_alpha ? BOUND_UPPER : best >= original_beta ? BOUND_LOWER : BOUND_EXACT;
+        result.move = best_move;
+        tt_store(s->tt, key, &result);
+    }
+
+    s->cut_by_depth = s->cut_by_depth || cut_before;
+    s->count = base;
+    return best;
+}
+
+static void search_init(search *s, board *game, const turn_limit *limit, transposition_table *tt) {
+    s->game = game;
+    s->player = game_player(game);
+    s->limit = limit;
+    s->tt = tt;
+    s->aborted = false;
+    s->actions = NULL;
+    s->count = 0;
+    s->capacity = 0;
+    s->units = NULL;
+    s->units_capacity = 0;
+}
+
+static void search_free(search *s) {
+    free(s->actions);
+    free(s->units);
+}
+
+/**
+ * Copies plan pl of the search into t.
+ */
+static void copy_plan(search *s, const plan *pl, turn *t) {
+    if (t->capacity < pl->length) {
+        t->capacity = pl->length;
+        t->actions = realloc(t->actions, t->capacity * sizeof(action));
+    }
+    t->count = pl->length;
+    if (t->count > 0) {
+        memcpy(t->actions, &s->actions[pl->start], t->count * sizeof(action));
+    }
+}
+
+void search_ponder(board *game, const turn_limit *limit, transposition_table *tt) {
+    search s;
+    plan plans[STANCES];
+    int depth;
+    int i;
+
+    search_init(&s, game, limit, tt);
+    int count = generate(&s, plans);
+    for (depth = 1; depth <= MAX_DEPTH && !s.aborted; depth++) {
+        s.cut_by_depth = false;
+        for (i = 0; i < count && !s.aborted; i++) {
+            // every reply with a full window, not only the refutation, as any of them may be played
+            child(&s, &plans[i], depth, 0, -INFINITE_SCORE, INFINITE_SCORE);
+        }
+        if (!s.cut_by_depth) {
+            break; // the whole tree has been searched
+        }
+    }
+    search_free(&s);
+}
+
+int search_candidates(board *game, turn candidates[CANDIDATE_TURNS]) {
+    search s;
+    plan plans[STANCES];
+    int count;
+    int i;
+
+    search_init(&s, game, NULL, NULL);
+    count = generate(&s, plans);
+    for (i = 0; i < count; i++) {
+        copy_plan(&s, &plans[i], &candidates[i]);
+    }
+    search_free(&s);
+
+    return count;
+}
+
+bool search_best_turn(board *game, const turn_limit *limit, transposition_table *tt, turn *best) {
+    search s;
+    plan plans[STANCES];
+    int depth;
+
+    search_init(&s, game, limit, tt);
+    int count = generate(&s, plans);
+    int best_index = 0;
+    bool found = false;
+
+    for (depth = 1; depth <= MAX_DEPTH; depth++) {
+        int alpha = -INFINITE_SCORE;
+        int iteration_best = 0;
+        int i;
+
+        s.cut_by_depth = false;
+        for (i = 0; i < count; i++) {
+            int score = child(&s, &plans[i], depth, 0, alpha, INFINITE_SCORE);
+            if (s.aborted) {
+                break;
+            }
+            if (score > alpha) {
+                alpha = score;
+                iteration_best = i;
+            }
+        }
+
+        if (s.aborted) {
+            if (depth == 1 && alpha > -INFINITE_SCORE) {
+                best_index = iteration_best; // nothing better is known
+                found = true;
+            }
+            break;
+        }
+
+        // the best turn of this iteration is tried first in the next one
+        plan chosen = plans[iteration_best];
+        for (i = iteration_best; i > 0; i--) {
+            plans[i] = plans[i - 1];
+        }
+        plans[0] = chosen;
+        best_index = 0;
+        found = true;
+
+        if (!s.cut_by_depth || abs(alpha) >= WIN_SCORE - MAX_DEPTH) {
+            break; // the whole tree has been searched or the result is already certain
+        }
+    }
+
+    if (found) {
+        copy_plan(&s, &plans[best_index], best);
+    }
+    search_free(&s);
+
+    return found;
+}
@@ -0,0 +1,108 @@
+ /** @file
+    Interface of alpha-beta search over whole turns of both players.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "engine.h"
+#include "transposition.h"
+
+/**
+ * Maximal number of candidate turns of a player in a position.
+ */
+#define CANDIDATE_TURNS 6
+
+enum ActionKind {
+    ACTION_MOVE = 0,
+    ACTION_PRODUCE_KNIGHT = 1,
+    ACTION_PRODUCE_PEASANT = 2
+};
+
+/**
+ * A single command of a player other than END_TURN.
+ */
+typedef struct def_action {
+    enum ActionKind kind;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+} action;
+
+/**
+ * Actions of one player in a single turn, in order of playing. END_TURN is implied.
+ */
+typedef struct def_turn {
+    action *actions;
+    size_t count;
+    size_t capacity;
+} turn;
+
+/**
+ * States of the cancel flag of a `turn_limit`.
+ */
+enum CancelState {
+    CANCEL_NONE = 0,
+    CANCEL_RAISED,                // by another thread, to stop the AI at once
+    CANCEL_TAKEN                  // noticed by the AI, which stops; its owner clears it after the turn
+};
+
+/**
+ * When an anytime AI has to stop thinking about a turn.
+ */
+typedef struct def_turn_limit {
+    long long deadline;           // time of `monotonic_ns`
+    int *cancelled;               // a `CancelState`, may be NULL
+} turn_limit;
+
+/**
+ * Current time of a monotonic clock in nanoseconds.
+ */
+long long monotonic_ns();
+
+/**
+ * Checks if the AI has to stop. Cheap enough to be called for every node of a search.
+ * A raised cancel is marked as taken, so that its owner can tell it has stopped this turn.
+ */
+bool limit_reached(const turn_limit *limit);
+
+/**
+ * Chooses the best turn for the AI, whose turn it has to be, and stores it in best.
+ * Runs iterative deepening alpha-beta, where every ply is a whole turn of one player,
+ * until the limit is reached. Candidate turns of a player come from
+ * a few stances of its knights and king; in each of them knights capture first,
+ * taking a king before anything else, and turns with better captures are searched first.
+ * Results are remembered in tt, if it is not NULL, and used whenever a position is reached again.
+ * The table may only be shared by searches of the same player. Leaves the game as it was.
+ * Returns false, leaving best untouched, when the limit is reached before any turn gets a score.
+ */
+bool search_best_turn(board *game, const turn_limit *limit, transposition_table *tt, turn *best);
+
+/**
+ * Searches the position of the game, where the opponent of the AI is to move, from the point
+ * of view of the AI: every candidate turn of the opponent with a full window, deeper and deeper,
+ * until the limit is reached or nothing more can be learned. Results go only
+ * to tt, from which `search_best_turn` of the AI takes them after the opponent has moved,
+ * so the positions after its candidate turns come already searched. Leaves the game as it was.
+ */
+void search_ponder(board *game, const turn_limit *limit, transposition_table *tt);
+
+/**
+ * Puts distinct candidate turns of the player to move, the ones searched by `search_best_turn`,
+ * into candidates, the most promising first, and returns their number. Turns in candidates have
+ * to be initialized, they are reused. Leaves the game as it was.
+ */
+int search_candidates(board *game, turn candidates[CANDIDATE_TURNS]);
+
+/**
+ * Frees memory of the turn.
+ */
+void turn_free(turn *t);
+
+#endif /* SEARCH_H */
@@ -0,0 +1,317 @@
+ /** @file
+    Server playing many games read from one input stream.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dispatch.h"
+#include "server.h"
+
+#define INITIAL_MAP_CAPACITY 64
+
+/**
+ * A single game together with commands waiting for it.
+ */
+typedef struct def_game_slot {
+    int id;
+    board *game;
+    output out;                   // AI commands printed during the current batch
+    bool finished;                // game is over, further commands are dropped
+    command *pending;             // commands read but not executed yet, protected by the queue lock
+    size_t pending_count;
+    size_t pending_capacity;
+    command *batch;               // commands being executed by a worker
+    size_t batch_capacity;
+    bool scheduled;               // slot is in the run queue or being run, protected by the queue lock
+    struct def_game_slot *next_scheduled;
+} game_slot;
+
+typedef struct def_server {
+    game_slot **slots;            // open addressing map from game id, used by the reading thread only
+    size_t slots_capacity;
+    size_t slots_count;
+    pthread_mutex_t queue_lock;   // guards run queue and pending commands of all slots
+    pthread_cond_t queue_nonempty;
+    game_slot *run_head;          // slots having pending commands, in order of scheduling
+    game_slot *run_tail;
+    bool closing;                 // input has ended
+    pthread_mutex_t output_lock;  // keeps lines of different games from interleaving
+    const ai_options *ai;         // AI playing in every game
+} server;
+
+static size_t slot_position(server *srv, int id) {
+    size_t mask = srv->slots_capacity - 1;
+    size_t position = ((unsigned int) id * 2654435761u) & mask;
+    while (srv->slots[position] != NULL && srv->slots[position]->id != id) {
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+static void grow_slots(server *srv) {
+    game_slot **old_slots = srv->slots;
+    size_t old_capacity = srv->slots_capacity;
+    size_t i;
+
+    srv->slots_capacity = old_capacity == 0 ? INITIAL_MAP_CAPACITY : 2 * old_capacity;
+    srv->slots = calloc(srv->slots_capacity, sizeof(game_slot *));
+    for (i = 0; i < old_capacity; i++) {
+        if (old_slots[i] != NULL) {
+            srv->slots[slot_position(srv, old_slots[i]->id)] = old_slots[i];
+        }
+    }
+    free(old_slots);
+}
+
+/**
+ * Returns slot of game id, creating it on first use.
+ */
+static game_slot* find_slot(server *srv, int id) {
+    if (2 * (srv->slots_count + 1) > srv->slots_capacity) {
+        grow_slots(srv);
+    }
+
+    size_t position = slot_position(srv, id);
+    if (srv->slots[position] == NULL) {
+        char prefix[16];
+        game_slot *slot = calloc(1, sizeof(game_slot));
+        slot->id = id;
+        slot->game = game_create();
+        snprintf(prefix, sizeof(prefix), "G%d ", id);
+        output_init(&slot->out, prefix);
+        game_set_output(slot->game, &slot->out);
+        game_set_ai(slot->game, srv->ai);
+        srv->slots[position] = slot;
+        srv->slots_count++;
+    }
+
+    return srv->slots[position];
+}
+
+static void free_slot(game_slot *slot) {
+    if (slot->game != NULL) {
+        game_destroy(slot->game);
+    }
+    output_free(&slot->out);
+    free(slot->pending);
+    free(slot->batch);
+    free(slot);
+}
+
+/**
+ * Appends slot to the run queue. Has to be called with the queue lock held.
+ */
+static void schedule(server *srv, game_slot *slot) {
+    slot->next_scheduled = NULL;
+    if (srv->run_tail == NULL) {
+        srv->run_head = slot;
+    } else {
+        srv->run_tail->next_scheduled = slot;
+    }
+    srv->run_tail = slot;
+    pthread_cond_signal(&srv->queue_nonempty);
+}
+
+/**
+ * Hands a command over to the game. Called by the reading thread.
+ */
+static void enqueue_command(server *srv, game_slot *slot, command *new_command) {
+    pthread_mutex_lock(&srv->queue_lock);
+    if (slot->pending_count == slot->pending_capacity) {
+        slot->pending_capacity = slot->pending_capacity == 0 ? 16 : 2 * slot->pending_capacity;
+        slot->pending = realloc(slot->pending, slot->pending_capacity * sizeof(command));
+    }
+    slot->pending[slot->pending_count++] = *new_command;
+    if (!slot->scheduled) {
+        slot->scheduled = true;
+        schedule(srv, slot);
+    }
+    pthread_mutex_unlock(&srv->queue_lock);
+}
+
+/**
+ * Executes a batch of commands of one game.
+ */
+static void run_batch(server *srv, game_slot *slot, size_t count) {
+    size_t i;
+    for (i = 0; i < count && !slot->finished; i++) {
+        int exit_code = execute_command(slot->game, &slot->batch[i]);
+        if (exit_code != RESULT_ONGOING) {
+            print_line(&slot->out, "GAME_OVER %d\n", exit_code);
+            game_destroy(slot->game);
+            slot->game = NULL;
+            slot->finished = true;
+        }
+    }
+
+    pthread_mutex_lock(&srv->output_lock);
+    output_flush(&slot->out, stdout);
+    pthread_mutex_unlock(&srv->output_lock);
+}
+
+static void* worker(void *arg) {
+    server *srv = arg;
+    game_slot *slot;
+    command *swapped;
+    size_t swapped_capacity;
+    size_t count;
+
+    pthread_mutex_lock(&srv->queue_lock);
+    while (true) {
+        while (srv->run_head == NULL && !srv->closing) {
+            pthread_cond_wait(&srv->queue_nonempty, &srv->queue_lock);
+        }
+        if (srv->run_head == NULL) {
+            break; // input has ended and all games are done
+        }
+
+        slot = srv->run_head;
+        srv->run_head = slot->next_scheduled;
+        if (srv->run_head == NULL) {
+            srv->run_tail = NULL;
+        }
+
+        // takes all pending commands at once, leaving the reader an empty array
+        swapped = slot->batch;
+        swapped_capacity = slot->batch_capacity;
+        slot->batch = slot->pending;
+        slot->batch_capacity = slot->pending_capacity;
+        count = slot->pending_count;
+        slot->pending = swapped;
+        slot->pending_capacity = swapped_capacity;
+        slot->pending_count = 0;
+        pthread_mutex_unlock(&srv->queue_lock);
+
+        run_batch(srv, slot, count);
+
+        pthread_mutex_lock(&srv->queue_lock);
+        if (slot->pending_count > 0) {
+            schedule(srv, slot);
+        } else {
+            slot->scheduled = false;
+        }
+    }
+    pthread_mutex_unlock(&srv->queue_lock);
+
+    return NULL;
+}
+
+/**
+ * Splits a line into game id and the command. Returns the command or NULL if there is no correct tag.
+ */
+static char* parse_tag(char *line, int *id) {
+    long value = 0;
+    char *c = line + 1;
+
+    if (line[0] != 'G' || !isdigit((unsigned char) *c)) {
+        return NULL;
+    }
+    while (isdigit((unsigned char) *c)) {
+        value = 10 * value + (*c - '0');
+        if (value > INT_MAX) {
+            return NULL;
+        }
+        c++;
+    }
+    if (*c != ' ') {
+        return NULL;
+    }
+
+    *id = (int) value;
+    return c + 1;
+}
+
+/**
+ * Prints `GAME_OVER` with the code a single game process exits with when its input ends,
+ * for every game that has not finished. Called after all workers have stopped.
+ */
+static void finish_open_games(server *srv) {
+    size_t i;
+    for (i = 0; i < srv->slots_capacity; i++) {
+        game_slot *slot = srv->slots[i];
+        if (slot != NULL && !slot->finished) {
+            print_line(&slot->out, "GAME_OVER %d\n", RESULT_WRONG_COMMAND);
+            output_flush(&slot->out, stdout);
+        }
+    }
+}
+
+int run_server(int threads, const ai_options *ai) {
+    server srv;
+    ai_options game_ai = *ai;
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_length;
+    command new_command;
+    size_t i;
+    int id;
+
+    srv.slots = NULL;
+    srv.slots_capacity = 0;
+    srv.slots_count = 0;
+    srv.run_head = NULL;
+    srv.run_tail = NULL;
+    srv.closing = false;
+    srv.ai = &game_ai;
+    pthread_mutex_init(&srv.queue_lock, NULL);
+    pthread_cond_init(&srv.queue_nonempty, NULL);
+    pthread_mutex_init(&srv.output_lock, NULL);
+    grow_slots(&srv);
+
+    while (started < threads && pthread_create(&workers[started], NULL, worker, &srv) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        fprintf(stderr, "cannot start server threads\n");
+    } else {
+        // games share the processors with each other, so none ponders and MCTS gets its share of them
+        game_ai.ponder = false;
+        game_ai.workers = ai->workers / started > 1 ? ai->workers / started : 1;
+    }
+
+    while (started > 0 && (line_length = getline(&line, &line_capacity, stdin)) > 0) {
+        char *text = parse_tag(line, &id);
+        if (text == NULL || line[line_length - 1] != '\n') {
+            fprintf(stderr, "input error: line without a game tag\n");
+            continue;
+        }
+
+        if (parse_line(text, &new_command) != 0) {
+            new_command.opcode = OPCODE_WRONG; // the game ends with RESULT_WRONG_COMMAND
+        }
+        enqueue_command(&srv, find_slot(&srv, id), &new_command);
+    }
+    free(line);
+
+    pthread_mutex_lock(&srv.queue_lock);
+    srv.closing = true;
+    pthread_cond_broadcast(&srv.queue_nonempty);
+    pthread_mutex_unlock(&srv.queue_lock);
+    for (i = 0; i < (size_t) started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    finish_open_games(&srv);
+
+    for (i = 0; i < srv.slots_capacity; i++) {
+        if (srv.slots[i] != NULL) {
+            free_slot(srv.slots[i]);
+        }
+    }
+    free(srv.slots);
+    pthread_mutex_destroy(&srv.queue_lock);
+    pthread_cond_destroy(&srv.queue_nonempty);
+    pthread_mutex_destroy(&srv.output_lock);
+
+    return started == 0 ? 1 : 0;
+}
@@ -0,0 +1,27 @@
+ /** @file
+    Interface of server playing many games read from one input stream.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "engine.h"
+
+/**
+ * Reads commands tagged with a game id (e.g. `G17 MOVE 3 4 4 5`) from stdin until EOF
+ * and plays every game in its own engine state on a pool of worker threads.
+ * AI commands are printed with the same tag; output of each game keeps its order.
+ * When a game finishes, `G<id> GAME_OVER <code>` is printed, where code is what
+ * a single game process would exit with. Later commands for that id are ignored.
+ * Games still going on at EOF end with `GAME_OVER 42`, as a single game whose input ends.
+ * Games do not ponder, and `ai->workers` threads of MCTS are split between the worker threads.
+ * @param[in] threads Number of worker threads.
+ * @param[in] ai AI playing in every game.
+ * @return Exit code of the server, 1 when no worker thread could be started.
+ */
+int run_server(int threads, const ai_options *ai);
+
+#endif /* SERVER_H */
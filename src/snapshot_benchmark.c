@@ -0,0 +1,78 @@
+ /** @file
+    Benchmark of snapshots of the game state.
+
+    For every board size given and a range of unit counts, fills a board with units
+    and prints the size of the state and the time of `game_snapshot` and `game_restore`:
+
+        snapshot_benchmark [N...]
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchmark_board.h"
+#include "engine.h"
+
+#define COPIED_BYTES (1LL << 31)  // about as many bytes are copied for every measurement
+#define MIN_REPETITIONS 100
+
+static const int default_sizes[] = {16, 128, 1024, 4096};
+static const int unit_counts[] = {8, 64, 512, 4096, 32768};
+
+/**
+ * Measures snapshots of a board of size n with about `units` units.
+ * @return 0, or -1 when the board is full with fewer units.
+ */
+static int measure(int n, int units) {
+    board *game = game_create();
+    board *restored = game_create();
+    snapshot snap = {NULL, 0, 0};
+    int filled = benchmark_board_fill(game, n, units);
+    int result = 0;
+
+    if (filled < 0) {
+        fprintf(stderr, "Board size %d too small for a game.\n", n);
+        result = -1;
+    } else if (filled < units) {
+        result = -1;
+    } else {
+        long long repetitions;
+        long long i;
+
+        game_snapshot(game, &snap);
+        game_restore(restored, &snap);
+        repetitions = COPIED_BYTES / (2 * (long long) snap.bytes) + MIN_REPETITIONS;
+        double started = benchmark_seconds_now();
+        for (i = 0; i < repetitions; i++) {
+            game_snapshot(game, &snap);
+            game_restore(restored, &snap);
+        }
+        double elapsed = benchmark_seconds_now() - started;
+
+        printf("n=%d units=%d state %zu bytes: %.3f us per snapshot and restore\n",
+               n, filled, snap.bytes, elapsed / repetitions * 1e6);
+    }
+
+    snapshot_free(&snap);
+    game_destroy(game);
+    game_destroy(restored);
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    int sizes = argc > 1 ? argc - 1 : (int) (sizeof(default_sizes) / sizeof(default_sizes[0]));
+    int i, j;
+
+    for (i = 0; i < sizes; i++) {
+        int n = argc > 1 ? atoi(argv[i + 1]) : default_sizes[i];
+        for (j = 0; j < (int) (sizeof(unit_counts) / sizeof(unit_counts[0])); j++) {
+            if (measure(n, unit_counts[j]) != 0) {
+                break;            // larger counts do not fit either
+            }
+        }
+    }
+
+    return 0;
+}
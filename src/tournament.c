@@ -0,0 +1,530 @@
+ /** @file
+    Round-robin tournament between AI programs, played in parallel without the GUI.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "match.h"
+
+#define MAX_PLAYERS 64
+#define MAX_GRID 64
+#define DEFAULT_GAMES 10
+
+/**
+ * Iterations of the Bradley-Terry fit; ratings of a round robin settle long before.
+ */
+#define RATING_ITERATIONS 10000
+
+/**
+ * Normal quantile of a 95% confidence interval.
+ */
+#define CONFIDENCE_Z 1.959964
+
+/**
+ * A single match to be played.
+ */
+typedef struct def_tournament_game {
+    int players[2];               // numbers of AI playing as the first and the second player
+    int n;
+    int k;
+    int x1, y1, x2, y2;
+    int played;                   // 0 when the match could not be started
+    match_result result;
+} tournament_game;
+
+typedef struct def_tournament {
+    char **programs[MAX_PLAYERS]; // argv of every AI
+    char *names[MAX_PLAYERS];
+    int players;
+    tournament_game *games;
+    size_t game_count;
+    size_t next_game;             // first game not taken by a worker yet
+    bool binary;
+    int turn_timeout_ms;
+} tournament;
+
+/**
+ * Wins, draws and losses of one AI against another or against the whole field.
+ */
+typedef struct def_record {
+    long wins;
+    long draws;
+    long losses;
+} record;
+
+static int usage(char *name) {
+    fprintf(stderr, "Usage: %s -ai ai1 -ai ai2 [-ai ai3 ...] [-n n1,n2,...] [-k k1,k2,...] [-games g] [-jobs j]"
+                    " [-binary] [-timeout ms] [-seed seed]\n", name);
+    return 1;
+}
+
+/**
+ * Parses a number from min to INT_MAX.
+ * @return 0, or -1 if text is not such a number.
+ */
+static int parse_number(const char *text, long min, int *value) {
+    char *end;
+    long parsed = strtol(text, &end, 10);
+
+    if (*text < '0' || *text > '9' || *end != '\0' || parsed < min || parsed > INT_MAX) {
+        return -1;
+    }
+
+    *value = (int) parsed;
+    return 0;
+}
+
+/**
+ * Parses a comma-separated list of numbers from min to INT_MAX.
+ * @return number of values, or -1 if list is incorrect.
+ */
+static int parse_grid(const char *list, long min, int *values) {
+    int count = 0;
+    char *end;
+
+    while (count < MAX_GRID) {
+        long parsed = strtol(list, &end, 10);
+        if (*list < '0' || *list > '9' || parsed < min || parsed > INT_MAX || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        values[count++] = (int) parsed;
+        if (*end == '\0') {
+            return count;
+        }
+        list = end + 1;
+    }
+
+    return -1; // error, too many values
+}
+
+static void* worker(void *arg) {
+    tournament *t = arg;
+    size_t i;
+
+    while ((i = __atomic_fetch_add(&t->next_game, 1, __ATOMIC_RELAXED)) < t->game_count) {
+        tournament_game *game = &t->games[i];
+        match_config config = {{t->programs[game->players[0]], t->programs[game->players[1]]},
+                               game->n, game->k, game->x1, game->y1, game->x2, game->y2,
+                               t->binary, t->turn_timeout_ms, -1, 0};
+
+        game->played = play_match(&config, &game->result) == 0;
+    }
+
+    return NULL;
+}
+
+/**
+ * Adds result of a game to the record of player p (0 or 1) of the game.
+ */
+static void count_game(record *r, const tournament_game *game, int p) {
+    if (game->result.winner == 0) {
+        r->draws++;
+    } else if (game->result.winner == p + 1) {
+        r->wins++;
+    } else {
+        r->losses++;
+    }
+}
+
+static long games_of(const record *r) {
+    return r->wins + r->draws + r->losses;
+}
+
+/**
+ * Score of record per game, 0.5 when no game has been played.
+ */
+static double score_of(const record *r) {
+    long games = games_of(r);
+    return games == 0 ? 0.5 : (r->wins + 0.5 * r->draws) / games;
+}
+
+/**
+ * Fits Bradley-Terry strengths to results of all pairs by minorization-maximization, with a draw
+ * counted as half a win and one virtual draw added between every pair, which keeps ratings
+ * of an AI winning or losing everything finite. Ratings are given in Elo with mean 0.
+ */
+static void fit_ratings(int players, record pairs[MAX_PLAYERS][MAX_PLAYERS], double *elo) {
+    double strength[MAX_PLAYERS];
+    double next[MAX_PLAYERS];
+    int iteration;
+    int i, j;
+
+    for (i = 0; i < players; i++) {
+        strength[i] = 1;
+    }
+
+    for (iteration = 0; iteration < RATING_ITERATIONS; iteration++) {
+        double log_sum = 0;
+
+        for (i = 0; i < players; i++) {
+            double points = 0;
+            double expected = 0;
+            for (j = 0; j < players; j++) {
+                if (j != i) {
+                    points += pairs[i][j].wins + 0.5 * pairs[i][j].draws + 0.5;
+                    expected += (games_of(&pairs[i][j]) + 1) / (strength[i] + strength[j]);
+                }
+            }
+            next[i] = points / expected;
+            log_sum += log(next[i]);
+        }
+
+        for (i = 0; i < players; i++) {
+            strength[i] = next[i] / exp(log_sum / players);
+        }
+    }
+
+    for (i = 0; i < players; i++) {
+        elo[i] = 400 * log10(strength[i]);
+    }
+}
+
+/**
+ * Expected score of a player rated elo_a against one rated elo_b in the Bradley-Terry model.
+ */
+static double expected_score(double elo_a, double elo_b) {
+    return 1 / (1 + pow(10, (elo_b - elo_a) / 400));
+}
+
+/**
+ * Covariance of ratings given by `fit_ratings`, in Elo squared: the inverse of the Fisher information
+ * of the Bradley-Terry likelihood at the fitted ratings, with the same virtual draw between every pair.
+ * The information is a Laplacian of the pairs, singular along a shift of all ratings, so it is
+ * inverted on ratings with mean 0, as its pseudo-inverse (L + J/players)^-1 - J/players.
+ */
+static void rating_covariance(int players, record pairs[MAX_PLAYERS][MAX_PLAYERS], const double *elo,
+                              double covariance[MAX_PLAYERS][MAX_PLAYERS]) {
+    static double m[MAX_PLAYERS][2 * MAX_PLAYERS]; // the matrix to invert, then the identity, eliminated together
+    double per_elo = log(10) / 400;               // natural log of strength per Elo point
+    int i, j, r;
+
+    for (i = 0; i < players; i++) {
+        for (j = 0; j < players; j++) {
+            m[i][j] = 1.0 / players;
+            m[i][players + j] = i == j;
+        }
+    }
+    for (i = 0; i < players; i++) {
+        for (j = i + 1; j < players; j++) {
+            double p = expected_score(elo[i], elo[j]);
+            double information = (games_of(&pairs[i][j]) + 1) * p * (1 - p) * per_elo * per_elo;
+            m[i][i] += information;
+            m[j][j] += information;
+            m[i][j] -= information;
+            m[j][i] -= information;
+        }
+    }
+
+    // Gauss-Jordan elimination, the matrix is positive definite so no pivoting is needed
+    for (i = 0; i < players; i++) {
+        double pivot = m[i][i];
+        for (j = 0; j < 2 * players; j++) {
+            m[i][j] /= pivot;
+        }
+        for (r = 0; r < players; r++) {
+            double factor = m[r][i];
+            if (r == i || factor == 0) {
+                continue;
+            }
+            for (j = 0; j < 2 * players; j++) {
+                m[r][j] -= factor * m[i][j];
+            }
+        }
+    }
+
+    for (i = 0; i < players; i++) {
+        for (j = 0; j < players; j++) {
+            covariance[i][j] = m[i][players + j] - 1.0 / players;
+        }
+    }
+}
+
+static void print_record(const record *r) {
+    char text[64];
+    snprintf(text, sizeof(text), "%ld-%ld-%ld", r->wins, r->draws, r->losses);
+    printf(" %12s", text);
+}
+
+static void print_score(const record *r) {
+    if (games_of(r) == 0) {
+        printf(" %6s", "-");
+    } else {
+        printf(" %5.1f%%", 100 * score_of(r));
+    }
+}
+
+/**
+ * Prints rating list, head to head results, results of every pair and results on every board.
+ */
+static void report(tournament *t, const int *sizes, int size_count, const int *rounds, int round_count) {
+    static record pairs[MAX_PLAYERS][MAX_PLAYERS];
+    static double covariance[MAX_PLAYERS][MAX_PLAYERS];
+    record totals[MAX_PLAYERS];
+    long forfeits[MAX_PLAYERS];
+    double elo[MAX_PLAYERS];
+    int order[MAX_PLAYERS];
+    size_t g;
+    int i, j, a, b;
+
+    memset(totals, 0, sizeof(totals));
+    memset(forfeits, 0, sizeof(forfeits));
+    for (g = 0; g < t->game_count; g++) {
+        tournament_game *game = &t->games[g];
+        if (!game->played) {
+            continue;
+        }
+        for (i = 0; i < 2; i++) {
+            count_game(&pairs[game->players[i]][game->players[1 - i]], game, i);
+            count_game(&totals[game->players[i]], game, i);
+        }
+        if (game->result.end != MATCH_KING_TAKEN && game->result.end != MATCH_ROUNDS_LIMIT) {
+            forfeits[game->players[2 - game->result.winner]]++;
+        }
+    }
+
+    fit_ratings(t->players, pairs, elo);
+    rating_covariance(t->players, pairs, elo, covariance);
+    for (i = 0; i < t->players; i++) {
+        order[i] = i;
+    }
+    for (i = 1; i < t->players; i++) { // insertion sort by rating
+        for (j = i; j > 0 && elo[order[j]] > elo[order[j - 1]]; j--) {
+            int swapped = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swapped;
+        }
+    }
+
+    printf("Rating list (Elo with mean 0, margin of the 95%% confidence interval):\n");
+    printf("%3s %8s %6s %6s %12s %6s %8s  %s\n", "#", "Elo", "+-", "games", "W-D-L", "score", "forfeits", "AI");
+    for (i = 0; i < t->players; i++) {
+        a = order[i];
+        printf("%3d %8.0f %6.0f %6ld", a + 1, elo[a], CONFIDENCE_Z * sqrt(covariance[a][a]), games_of(&totals[a]));
+        print_record(&totals[a]);
+        print_score(&totals[a]);
+        printf(" %8ld  %s\n", forfeits[a], t->names[a]);
+    }
+
+    printf("\nHead to head (W-D-L of the row against the column):\n%3s", "");
+    for (j = 0; j < t->players; j++) {
+        printf(" %12d", j + 1);
+    }
+    printf("\n");
+    for (i = 0; i < t->players; i++) {
+        printf("%3d", i + 1);
+        for (j = 0; j < t->players; j++) {
+            if (i == j) {
+                printf(" %12s", "-");
+            } else {
+                print_record(&pairs[i][j]);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("\nPairs (rating difference of the first AI, margin of the 95%% confidence interval):\n");
+    for (a = 0; a < t->players; a++) {
+        for (b = a + 1; b < t->players; b++) {
+            double variance = covariance[a][a] + covariance[b][b] - 2 * covariance[a][b];
+            printf("%3d vs %-3d", a + 1, b + 1);
+            print_record(&pairs[a][b]);
+            print_score(&pairs[a][b]);
+            printf(" %+8.0f %6.0f\n", elo[a] - elo[b], CONFIDENCE_Z * sqrt(variance));
+        }
+    }
+
+    printf("\nBoards (W-D-L of every AI):\n%10s %10s", "n", "k");
+    for (j = 0; j < t->players; j++) {
+        printf(" %12d", j + 1);
+    }
+    printf("\n");
+    for (a = 0; a < size_count; a++) {
+        for (b = 0; b < round_count; b++) {
+            record cell[MAX_PLAYERS];
+            memset(cell, 0, sizeof(cell));
+            for (g = 0; g < t->game_count; g++) {
+                tournament_game *game = &t->games[g];
+                if (game->played && game->n == sizes[a] && game->k == rounds[b]) {
+                    count_game(&cell[game->players[0]], game, 0);
+                    count_game(&cell[game->players[1]], game, 1);
+                }
+            }
+            printf("%10d %10d", sizes[a], rounds[b]);
+            for (j = 0; j < t->players; j++) {
+                print_record(&cell[j]);
+            }
+            printf("\n");
+        }
+    }
+}
+
+/**
+ * Usage: tournament -ai ai1 -ai ai2 [-ai ai3 ...] [-n n1,n2,...] [-k k1,k2,...] [-games g] [-jobs j]
+ *                   [-binary] [-timeout ms] [-seed seed]
+ * Plays a round robin between AI programs (command lines, e.g. "./middle_ages -ai mcts") on every board
+ * size n and round limit k of the grids (10 and 100 by default). Every pair plays g starting positions
+ * (10 by default), picked as game.sh does, on every board, each of them twice with sides swapped.
+ * Matches are played by j workers at once (all processors by default), see `play_match`.
+ * -binary and -timeout are passed to every match as by the arbiter; -seed makes positions the same in every run.
+ * Prints the rating list, head to head results and results on every board.
+ */
+int main(int argc, char *argv[]) {
+    tournament t;
+    int sizes[MAX_GRID] = {10};
+    int size_count = 1;
+    int rounds[MAX_GRID] = {100};
+    int round_count = 1;
+    int games = DEFAULT_GAMES;
+    int jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t seed = (uint64_t) time(NULL) ^ ((uint64_t) getpid() << 32);
+    int i, a, b, s, r, p;
+
+    memset(&t, 0, sizeof(t));
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-binary") == 0) {
+            t.binary = true;
+        } else if (i + 1 == argc) {
+            return usage(argv[0]); // all other options have a value
+        } else if (strcmp(argv[i], "-ai") == 0) {
+            if (t.players == MAX_PLAYERS) {
+                fprintf(stderr, "At most %d AI can play.\n", MAX_PLAYERS);
+                return 1;
+            }
+            t.names[t.players] = argv[++i];
+            t.programs[t.players] = split_program(argv[i]);
+            if (t.programs[t.players++][0] == NULL) {
+                return usage(argv[0]);
+            }
+        } else if (strcmp(argv[i], "-n") == 0) {
+            if ((size_count = parse_grid(argv[++i], 9, sizes)) < 0) {
+                fprintf(stderr, "Parameter \"n\" is not a list of numbers from 9 to %d.\n", INT_MAX);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-k") == 0) {
+            if ((round_count = parse_grid(argv[++i], 1, rounds)) < 0) {
+                fprintf(stderr, "Parameter \"k\" is not a list of positive numbers.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-games") == 0) {
+            if (parse_number(argv[++i], 1, &games) != 0) {
+                fprintf(stderr, "Parameter \"games\" is not a positive number.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-jobs") == 0) {
+            if (parse_number(argv[++i], 1, &jobs) != 0) {
+                fprintf(stderr, "Parameter \"jobs\" is not a positive number.\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-timeout") == 0) {
+            if (parse_number(argv[++i], 0, &t.turn_timeout_ms) != 0) {
+                fprintf(stderr, "Parameter \"timeout\" is not a number from 0 to %d.\n", INT_MAX);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-seed") == 0) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    if (t.players < 2) {
+        return usage(argv[0]);
+    }
+    if (jobs < 1) {
+        jobs = 1;                 // the number of processors is unknown
+    }
+
+    // every pair plays the same positions, each of them from both sides
+    t.game_count = (size_t) t.players * (t.players - 1) * size_count * round_count * games;
+    t.games = calloc(t.game_count, sizeof(tournament_game));
+    pthread_t *workers = malloc((size_t) jobs * sizeof(pthread_t));
+    if (t.games == NULL || workers == NULL) {
+        fprintf(stderr, "Cannot allocate %zu matches.\n", t.game_count);
+        for (i = 0; i < t.players; i++) {
+            free(t.programs[i]);
+        }
+        free(t.games);
+        free(workers);
+        return 1;
+    }
+
+    size_t g = 0;
+    for (s = 0; s < size_count; s++) {
+        for (r = 0; r < round_count; r++) {
+            for (i = 0; i < games; i++) {
+                int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+                pick_start_positions(sizes[s], &seed, &x1, &y1, &x2, &y2);
+                for (a = 0; a < t.players; a++) {
+                    for (b = a + 1; b < t.players; b++) {
+                        for (p = 0; p < 2; p++) {
+                            tournament_game *game = &t.games[g++];
+                            game->players[p] = a;
+                            game->players[1 - p] = b;
+                            game->n = sizes[s];
+                            game->k = rounds[r];
+                            game->x1 = x1;
+                            game->y1 = y1;
+                            game->x2 = x2;
+                            game->y2 = y2;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN); // an AI may exit before reading everything
+
+    struct timespec start, end;
+    int started = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (started < jobs && pthread_create(&workers[started], NULL, worker, &t) == 0) {
+        started++;
+    }
+    if (started < jobs) {
+        fprintf(stderr, "Started %d of %d workers.\n", started, jobs);
+    }
+    if (started == 0) {
+        worker(&t); // matches are played one by one instead
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int exit_code = 0;
+    size_t failed = 0;
+    for (g = 0; g < t.game_count; g++) {
+        failed += !t.games[g].played;
+    }
+    if (failed > 0) {
+        fprintf(stderr, "%zu matches could not be started.\n", failed);
+        exit_code = 1;
+    }
+
+    printf("%zu matches of %d AI played by %d workers in %.1f s\n\n", t.game_count - failed, t.players,
+           started > 0 ? started : 1, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    for (i = 0; i < t.players; i++) {
+        printf("%3d: %s\n", i + 1, t.names[i]);
+    }
+    printf("\n");
+    report(&t, sizes, size_count, rounds, round_count);
+
+    for (i = 0; i < t.players; i++) {
+        free(t.programs[i]);
+    }
+    free(t.games);
+    free(workers);
+    return exit_code;
+}
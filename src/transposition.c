@@ -0,0 +1,63 @@
+ /** @file
+    Transposition table of searched positions.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <stdlib.h>
+#include "transposition.h"
+
+/**
+ * Packs data into a single word: score in the lowest 32 bits, then depth, bound and move, 8 bits each.
+ */
+static uint64_t pack(const tt_data *data) {
+    return (uint64_t) (uint32_t) data->score |
+           (uint64_t) (data->depth & 0xff) << 32 |
+           (uint64_t) (data->bound & 0xff) << 40 |
+           (uint64_t) (data->move & 0xff) << 48;
+}
+
+static void unpack(uint64_t word, tt_data *data) {
+    data->score = (int32_t) (uint32_t) word;
+    data->depth = (int) (word >> 32 & 0xff);
+    data->bound = (enum Bound) (word >> 40 & 0xff);
+    data->move = (int) (word >> 48 & 0xff);
+}
+
+void tt_init(transposition_table *tt, unsigned int size_log2) {
+    tt->mask = ((uint64_t) 1 << size_log2) - 1;
+    tt->entries = calloc(tt->mask + 1, sizeof(tt_entry));
+}
+
+void tt_free(transposition_table *tt) {
+    free(tt->entries);
+    tt->entries = NULL;
+    tt->mask = 0;
+}
+
+bool tt_probe(transposition_table *tt, uint64_t key, tt_data *data) {
+    tt_entry *entry = &tt->entries[key & tt->mask];
+    uint64_t word = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+
+    if ((check ^ word) != key || (check | word) == 0) {
+        return false; // other position, a torn write or an empty slot
+    }
+
+    unpack(word, data);
+    return true;
+}
+
+void tt_store(transposition_table *tt, uint64_t key, const tt_data *data) {
+    tt_entry *entry = &tt->entries[key & tt->mask];
+    uint64_t word = pack(data);
+    tt_data old;
+
+    if (tt_probe(tt, key, &old) && old.depth > data->depth) {
+        return;
+    }
+
+    __atomic_store_n(&entry->data, word, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->check, key ^ word, __ATOMIC_RELAXED);
+}
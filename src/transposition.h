@@ -0,0 +1,73 @@
+ /** @file
+    Interface of transposition table of searched positions.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Depth stored for positions searched to the end of the game, deeper than any real depth.
+ */
+#define TT_DEPTH_FULL 255
+
+enum Bound {
+    BOUND_EXACT = 0,
+    BOUND_LOWER = 1,              // the real score is at least the stored one
+    BOUND_UPPER = 2               // the real score is at most the stored one
+};
+
+/**
+ * What is known about a searched position.
+ */
+typedef struct def_tt_data {
+    int score;
+    int depth;                    // in [0, TT_DEPTH_FULL]
+    enum Bound bound;
+    int move;                     // index of the best candidate turn, in [0, 255]
+} tt_data;
+
+/**
+ * Slot of the table. check is the key xor packed data, so a slot torn by concurrent
+ * writers does not match any key and is treated as empty.
+ */
+typedef struct def_tt_entry {
+    uint64_t check;
+    uint64_t data;
+} tt_entry;
+
+/**
+ * Fixed size table of positions by their hash. Probing and storing take no locks,
+ * so the table may be shared by threads searching the same game.
+ */
+typedef struct def_transposition_table {
+    tt_entry *entries;
+    uint64_t mask;                // number of entries - 1, a power of two - 1
+} transposition_table;
+
+/**
+ * Allocates an empty table of 2^size_log2 entries.
+ */
+void tt_init(transposition_table *tt, unsigned int size_log2);
+
+/**
+ * Frees memory of the table.
+ */
+void tt_free(transposition_table *tt);
+
+/**
+ * Looks up position with the given hash. Returns whether it was found and fills data then.
+ */
+bool tt_probe(transposition_table *tt, uint64_t key, tt_data *data);
+
+/**
+ * Remembers data of position with the given hash. A deeper result of the same position is kept.
+ */
+void tt_store(transposition_table *tt, uint64_t key, const tt_data *data);
+
+#endif /* TRANSPOSITION_H */
@@ -0,0 +1,228 @@
+ /** @file
+    Coordinate index of units.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "unit_index.h"
+
+#define MIN_CAPACITY 64
+
+/**
+ * Mixes both coordinates into a slot number (finalizer of splitmix64).
+ */
+static unsigned int hash_position(int x, int y, unsigned int capacity) {
+    uint64_t h = ((uint64_t) (uint32_t) x << 32) | (uint32_t) y;
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+
+    return (unsigned int) h & (capacity - 1);
+}
+
+/**
+ * Capacity of a hash table holding up to `values` values with load factor at most 1/2.
+ */
+static unsigned int hash_capacity(unsigned int values) {
+    unsigned int capacity = MIN_CAPACITY;
+    while (capacity < 2 * values) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/**
+ * Number of bytes rounded up to a multiple of 8.
+ */
+static size_t aligned(size_t bytes) {
+    return (bytes + 7) & ~(size_t) 7;
+}
+
+/**
+ * Whether a board of size n holding up to `values` values is indexed by a grid.
+ */
+static bool uses_grid(int n, unsigned int values) {
+    return n <= GRID_INDEX_MAX_SIZE && (size_t) n * n * sizeof(int) <=
+           (size_t) GRID_INDEX_MAX_RATIO * hash_capacity(values) * sizeof(index_entry);
+}
+
+size_t unit_index_bytes(int n, unsigned int values) {
+    if (uses_grid(n, values)) {
+        return aligned((size_t) n * n * sizeof(int));
+    }
+
+    return aligned(hash_capacity(values) * sizeof(index_entry));
+}
+
+void unit_index_init(unit_index *index, int n, unsigned int values, void *memory) {
+    size_t i;
+
+    index->size = n;
+    index->count = 0;
+    index->entries = NULL;
+    index->grid = NULL;
+    index->capacity = 0;
+
+    if (uses_grid(n, values)) {
+        index->kind = INDEX_GRID;
+        index->grid = memory;
+        memset(index->grid, 0xff, (size_t) n * n * sizeof(int)); // all bytes set give INDEX_EMPTY
+    } else {
+        index->kind = INDEX_HASH;
+        index->capacity = hash_capacity(values);
+        index->entries = memory;
+        for (i = 0; i < index->capacity; i++) {
+            index->entries[i].value = INDEX_EMPTY;
+        }
+    }
+}
+
+void unit_index_bind(unit_index *index, void *memory) {
+    if (index->kind == INDEX_GRID) {
+        index->grid = memory;
+    } else {
+        index->entries = memory;
+    }
+}
+
+/**
+ * Returns cell of the grid holding (x, y).
+ */
+static int* grid_cell(unit_index *index, int x, int y) {
+    return &index->grid[(size_t) (y - 1) * index->size + (x - 1)];
+}
+
+/**
+ * Order of entries with the same home slot.
+ */
+static bool precedes(const index_entry *a, const index_entry *b) {
+    return a->x < b->x || (a->x == b->x && a->y < b->y);
+}
+
+/**
+ * Returns slot holding (x, y) or an empty slot if it is not indexed.
+ */
+static unsigned int find_slot(unit_index *index, int x, int y) {
+    unsigned int mask = index->capacity - 1;
+    unsigned int slot = hash_position(x, y, index->capacity);
+    while (index->entries[slot].value != INDEX_EMPTY &&
+           (index->entries[slot].x != x || index->entries[slot].y != y)) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+void unit_index_copy(unit_index *index, const unit_index *from, unsigned int values, void *memory) {
+    size_t cells = (size_t) from->size * from->size;
+    size_t i;
+
+    if (from->kind == INDEX_GRID && uses_grid(from->size, values)) {
+        *index = *from;
+        index->grid = memory;
+        memcpy(index->grid, from->grid, cells * sizeof(int));
+        return;
+    }
+
+    unit_index_init(index, from->size, values, memory);
+    if (from->kind == INDEX_GRID) {
+        for (i = 0; i < cells; i++) {
+            if (from->grid[i] != INDEX_EMPTY) {
+                unit_index_insert(index, (int) (i % from->size) + 1, (int) (i / from->size) + 1, from->grid[i]);
+            }
+        }
+    } else {
+        for (i = 0; i < from->capacity; i++) {
+            if (from->entries[i].value != INDEX_EMPTY) {
+                unit_index_insert(index, from->entries[i].x, from->entries[i].y, from->entries[i].value);
+            }
+        }
+    }
+}
+
+int unit_index_find(unit_index *index, int x, int y) {
+    if (index->kind == INDEX_GRID) {
+        return *grid_cell(index, x, y);
+    }
+
+    return index->entries[find_slot(index, x, y)].value;
+}
+
+void unit_index_insert(unit_index *index, int x, int y, int value) {
+    if (index->kind == INDEX_GRID) {
+        int *cell = grid_cell(index, x, y);
+        index->count += (*cell == INDEX_EMPTY);
+        *cell = value;
+        return;
+    }
+
+    unsigned int slot = find_slot(index, x, y);
+    if (index->entries[slot].value != INDEX_EMPTY) {
+        index->entries[slot].value = value;
+        return;
+    }
+    index->count++;
+
+    // Robin Hood insertion: entries of a cluster stay sorted by their home slot and then by position,
+    // so the layout depends only on the values indexed, not on the order of inserts and removes,
+    // and taking back an action restores the table exactly
+    unsigned int mask = index->capacity - 1;
+    unsigned int distance = 0;
+    index_entry entry = {x, y, value};
+    slot = hash_position(x, y, index->capacity);
+    while (index->entries[slot].value != INDEX_EMPTY) {
+        index_entry *resident = &index->entries[slot];
+        unsigned int resident_distance = (slot - hash_position(resident->x, resident->y, index->capacity)) & mask;
+        if (resident_distance < distance || (resident_distance == distance && precedes(&entry, resident))) {
+            index_entry displaced = *resident;
+            *resident = entry;
+            entry = displaced;
+            distance = resident_distance;
+        }
+        slot = (slot + 1) & mask;
+        distance++;
+    }
+
+    index->entries[slot] = entry;
+}
+
+void unit_index_remove(unit_index *index, int x, int y) {
+    if (index->kind == INDEX_GRID) {
+        int *cell = grid_cell(index, x, y);
+        index->count -= (*cell != INDEX_EMPTY);
+        *cell = INDEX_EMPTY;
+        return;
+    }
+
+    unsigned int mask = index->capacity - 1;
+    unsigned int hole = find_slot(index, x, y);
+    unsigned int slot = hole;
+    unsigned int home;
+
+    if (index->entries[hole].value == INDEX_EMPTY) {
+        return;
+    }
+
+    // backward shift deletion: move later entries of the cluster into the hole, so no tombstones are needed
+    while (true) {
+        slot = (slot + 1) & mask;
+        if (index->entries[slot].value == INDEX_EMPTY) {
+            break;
+        }
+
+        home = hash_position(index->entries[slot].x, index->entries[slot].y, index->capacity);
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            index->entries[hole] = index->entries[slot];
+            hole = slot;
+        }
+    }
+
+    index->entries[hole].value = INDEX_EMPTY;
+    index->count--;
+}
@@ -0,0 +1,98 @@
+ /** @file
+    Interface of coordinate index of units.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef UNIT_INDEX_H
+#define UNIT_INDEX_H
+
+#include <stddef.h>
+
+/**
+ * Boards with size up to this value may be indexed by a dense grid, larger ones by a hash table.
+ */
+#ifndef GRID_INDEX_MAX_SIZE
+#define GRID_INDEX_MAX_SIZE 1024
+#endif
+
+/**
+ * The grid is used only when it takes at most this many times the memory of the hash table
+ * for the same number of values, as the index is copied with the state it is a part of.
+ * A board with few units is thus indexed by a hash table until the units fill it up.
+ */
+#ifndef GRID_INDEX_MAX_RATIO
+#define GRID_INDEX_MAX_RATIO 4
+#endif
+
+/**
+ * Value of a field with no unit.
+ */
+#define INDEX_EMPTY (-1)
+
+enum IndexKind {
+    INDEX_HASH = 0,
+    INDEX_GRID = 1
+};
+
+typedef struct def_index_entry {
+    int x;
+    int y;
+    int value;                    // INDEX_EMPTY marks an empty slot
+} index_entry;
+
+/**
+ * Maps (x, y) to the number of the unit standing there. Either an open addressing hash table
+ * or, on small or crowded boards, a flat size x size grid. The memory of both is given by the owner
+ * of the index, so that the index can be a part of a larger block of memory.
+ */
+typedef struct def_unit_index {
+    enum IndexKind kind;
+    index_entry *entries;         // hash table, used when kind == INDEX_HASH
+    unsigned int capacity;        // always a power of two, at least twice the number of values
+    unsigned int count;           // number of occupied slots
+    int *grid;                    // row-major grid, used when kind == INDEX_GRID
+    int size;                     // size of a board
+} unit_index;
+
+/**
+ * Number of bytes of memory of an index for a board of size n holding up to `values` values,
+ * a multiple of 8.
+ */
+size_t unit_index_bytes(int n, unsigned int values);
+
+/**
+ * Prepares an empty index for a board of size n, choosing its backend.
+ * memory has to hold `unit_index_bytes(n, values)` bytes.
+ */
+void unit_index_init(unit_index *index, int n, unsigned int values, void *memory);
+
+/**
+ * Points the index to memory, holding a copy of its contents.
+ */
+void unit_index_bind(unit_index *index, void *memory);
+
+/**
+ * Makes index a copy of from, holding up to `values` values, in memory of `unit_index_bytes` bytes.
+ * The backend is chosen anew for `values`, so the copy may be a grid when from is a hash table.
+ */
+void unit_index_copy(unit_index *index, const unit_index *from, unsigned int values, void *memory);
+
+/**
+ * Returns value of (x, y) or `INDEX_EMPTY` if the field is empty.
+ * (x, y) has to lie on the board.
+ */
+int unit_index_find(unit_index *index, int x, int y);
+
+/**
+ * Puts non-negative value on (x, y), replacing any value indexed there before.
+ */
+void unit_index_insert(unit_index *index, int x, int y, int value);
+
+/**
+ * Removes (x, y) from the index. Does nothing when the field is empty.
+ */
+void unit_index_remove(unit_index *index, int x, int y);
+
+#endif /* UNIT_INDEX_H */
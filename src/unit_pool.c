@@ -0,0 +1,50 @@
+ /** @file
+    Allocator of units.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#include <stdlib.h>
+#include "engine.h"
+#include "unit_pool.h"
+
+void unit_pool_init(unit_pool *pool, unit *units, unsigned int capacity) {
+    pool->units = units;
+    pool->capacity = capacity;
+    pool->used = 0;
+    pool->free_list = NO_UNIT;
+    pool->acquired = 0;
+    pool->released = 0;
+}
+
+void unit_pool_bind(unit_pool *pool, unit *units, unsigned int capacity) {
+    pool->units = units;
+    pool->capacity = capacity;
+}
+
+unsigned int unit_pool_in_use(unit_pool *pool) {
+    return (unsigned int) (pool->acquired - pool->released);
+}
+
+unit* unit_pool_acquire(unit_pool *pool) {
+    unit *u;
+
+    if (pool->free_list != NO_UNIT) {
+        u = &pool->units[pool->free_list];
+        pool->free_list = u->next;
+    } else if (pool->used < pool->capacity) {
+        u = &pool->units[pool->used++];
+    } else {
+        return NULL;
+    }
+
+    pool->acquired++;
+    return u;
+}
+
+void unit_pool_release(unit_pool *pool, unit *u) {
+    pool->released++;
+    u->next = pool->free_list;
+    pool->free_list = (int) (u - pool->units);
+}
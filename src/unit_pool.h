@@ -0,0 +1,52 @@
+ /** @file
+    Interface of allocator of units.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-16
+ */
+
+#ifndef UNIT_POOL_H
+#define UNIT_POOL_H
+
+struct def_unit;
+
+/**
+ * Units are cut out of a single array given by the owner and released units are reused
+ * through a free list, so a game in a steady state does not call malloc at all.
+ * Units are linked by their numbers in the array, so the pool can be copied together with it.
+ */
+typedef struct def_unit_pool {
+    struct def_unit *units;       // array of capacity units
+    unsigned int capacity;
+    unsigned int used;            // units already cut out of the array
+    int free_list;                // released units, linked through their next number
+    unsigned long acquired;       // number of units handed out
+    unsigned long released;       // number of units given back
+} unit_pool;
+
+/**
+ * Prepares an empty pool of capacity units in array units.
+ */
+void unit_pool_init(unit_pool *pool, struct def_unit *units, unsigned int capacity);
+
+/**
+ * Points the pool to units, holding a copy of its array, possibly larger.
+ */
+void unit_pool_bind(unit_pool *pool, struct def_unit *units, unsigned int capacity);
+
+/**
+ * Number of units handed out and not given back.
+ */
+unsigned int unit_pool_in_use(unit_pool *pool);
+
+/**
+ * Returns memory for a new unit, NULL when all capacity units are in use.
+ */
+struct def_unit* unit_pool_acquire(unit_pool *pool);
+
+/**
+ * Gives unit u back to the pool.
+ */
+void unit_pool_release(unit_pool *pool, struct def_unit *u);
+
+#endif /* UNIT_POOL_H */
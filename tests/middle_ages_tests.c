@@ -0,0 +1,442 @@
+ /** @file
+    Tests of the game protocol parser and of taking back actions of the engine.
+
+    @author Maciej Gontar <mg277344@mimuw.edu.pl>
+    @date 2026-10-17
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmocka.h>
+#include "../src/parse.h"
+#include "../src/engine.c"        // for the state compared in `test_make_unmake`
+
+#define WALKS 300
+#define WALK_ACTIONS 80
+#define ATTEMPTS 50               // random actions tried for each one made
+
+/**
+ * Command stream reading `length` bytes of input from a temporary file.
+ */
+typedef struct def_stream_input {
+    FILE *file;
+    command_stream stream;
+} stream_input;
+
+static stream_input* stream_open(const char *input, size_t length) {
+    stream_input *in = malloc(sizeof(stream_input));
+    in->file = tmpfile();
+    assert_non_null(in->file);
+    assert_int_equal(fwrite(input, 1, length, in->file), length);
+    fflush(in->file);
+    rewind(in->file);
+    command_stream_init(&in->stream, fileno(in->file), 0);
+    return in;
+}
+
+static void stream_close(stream_input *in) {
+    fclose(in->file);
+    free(in);
+}
+
+/**
+ * Results of `command_stream_next` for all lines of input, with the last command parsed.
+ * @return number of results written, up to `max`, the last being `COMMAND_STREAM_END`.
+ */
+static int stream_results(const char *input, size_t length, int *results, int max, command *last) {
+    stream_input *in = stream_open(input, length);
+    int count = 0;
+
+    do {
+        results[count] = command_stream_next(&in->stream, last);
+    } while (results[count++] != COMMAND_STREAM_END && count < max);
+
+    stream_close(in);
+    return count;
+}
+
+static int parses(const char *line) {
+    command parsed;
+    return parse_line((char *) line, &parsed);
+}
+
+static void test_correct_commands(void **state) {
+    command parsed;
+    (void) state;
+
+    assert_int_equal(parse_line("INIT 10 100 1 1 1 10 10\n", &parsed), 0);
+    assert_int_equal(parsed.opcode, OPCODE_INIT);
+    assert_int_equal(parsed.data[0], 10);
+    assert_int_equal(parsed.data[6], 10);
+
+    assert_int_equal(parse_line("MOVE 1 2 3 4\n", &parsed), 0);
+    assert_int_equal(parsed.opcode, OPCODE_MOVE);
+    assert_int_equal(parsed.data[3], 4);
+
+    assert_int_equal(parse_line("PRODUCE_KNIGHT 1 1 2 2\n", &parsed), 0);
+    assert_int_equal(parsed.opcode, OPCODE_PRODUCE_KNIGHT);
+    assert_int_equal(parse_line("PRODUCE_PEASANT 1 1 2 2\n", &parsed), 0);
+    assert_int_equal(parsed.opcode, OPCODE_PRODUCE_PEASANT);
+    assert_int_equal(parse_line("END_TURN\n", &parsed), 0);
+    assert_int_equal(parsed.opcode, OPCODE_END_TURN);
+}
+
+static void test_spaces(void **state) {
+    (void) state;
+
+    assert_int_equal(parses("MOVE 1  2 3 4\n"), -1);
+    assert_int_equal(parses("MOVE  1 2 3 4\n"), -1);
+    assert_int_equal(parses("MOVE 1 2 3 4 \n"), -1);
+    assert_int_equal(parses(" MOVE 1 2 3 4\n"), -1);
+    assert_int_equal(parses("MOVE\t1 2 3 4\n"), -1);
+    assert_int_equal(parses("END_TURN \n"), -1);
+    assert_int_equal(parses("INIT 1000 1000 1 1 1  1000 1000\n"), -1);
+}
+
+static void test_number_range(void **state) {
+    command parsed;
+    (void) state;
+
+    assert_int_equal(parses("MOVE 0 2 3 4\n"), -1);
+    assert_int_equal(parses("MOVE 1 2 3 00\n"), -1);
+    assert_int_equal(parse_line("MOVE 1 2 3 2147483647\n", &parsed), 0);
+    assert_int_equal(parsed.data[3], 2147483647);
+    assert_int_equal(parses("MOVE 1 2 3 2147483648\n"), -1);
+    assert_int_equal(parses("MOVE 1 2 3 99999999999999999999\n"), -1);
+    assert_int_equal(parses("MOVE 1 2 3 -4\n"), -1);
+
+    // long enough for the numbers to be read a word at a time
+    assert_int_equal(parse_line("INIT 2147483647 2147483647 1 1 1 2147483647 2147483647\n", &parsed), 0);
+    assert_int_equal(parsed.data[6], 2147483647);
+    assert_int_equal(parses("INIT 2147483648 2147483647 1 1 1 2147483647 2147483647\n"), -1);
+    assert_int_equal(parses("INIT 10000000000 100 1 1 1 10 10\n"), -1);
+    assert_int_equal(parses("INIT 10 100 1 1 1 10 0\n"), -1);
+    assert_int_equal(parses("INIT 00000000 100 1 1 1 10 10\n"), -1);
+}
+
+static void test_stream_number_range(void **state) {
+    const char input[] = "INIT 10 100 1 1 1 10 0\n"
+                         "INIT 2147483648 100 1 1 1 10 10\n"
+                         "MOVE 1 2 3 2147483647\n"
+                         "MOVE 1  2 3 4\n";
+    int results[8];
+    command last;
+    (void) state;
+
+    assert_int_equal(stream_results(input, strlen(input), results, 8, &last), 5);
+    assert_int_equal(results[0], -1);
+    assert_int_equal(results[1], -1);
+    assert_int_equal(results[2], 0);
+    assert_int_equal(results[3], -1);
+    assert_int_equal(results[4], COMMAND_STREAM_END);
+}
+
+static void test_missing_newline(void **state) {
+    const char input[] = "END_TURN\nEND_TURN";
+    int results[8];
+    command last;
+    (void) state;
+
+    assert_int_equal(parses("END_TURN"), -1);
+    assert_int_equal(parses("MOVE 1 2 3 4"), -1);
+    assert_int_equal(parses(""), -1);
+
+    assert_int_equal(stream_results(input, strlen(input), results, 8, &last), 3);
+    assert_int_equal(results[0], 0);
+    assert_int_equal(results[1], -1);
+    assert_int_equal(results[2], COMMAND_STREAM_END);
+}
+
+static void test_long_lines(void **state) {
+    size_t lengths[] = {MAX_COMMAND_LENGTH, MAX_COMMAND_LENGTH + 1, COMMAND_STREAM_BLOCK - 1,
+                        COMMAND_STREAM_BLOCK, 3 * COMMAND_STREAM_BLOCK + 7};
+    const char after[] = "MOVE 1 2 3 4\n";
+    char line[MAX_COMMAND_LENGTH + 2];
+    size_t i;
+    (void) state;
+
+    // a command padded with digits up to the longest line allowed, and one byte over it
+    memset(line, '1', sizeof(line));
+    memcpy(line, "MOVE 1 2 3 ", 11);
+    line[MAX_COMMAND_LENGTH - 1] = '\n';
+    line[MAX_COMMAND_LENGTH] = '\0';
+    assert_int_equal(parses(line), -1); // the number is too big, but the length is allowed
+    line[MAX_COMMAND_LENGTH - 1] = '1';
+    line[MAX_COMMAND_LENGTH] = '\n';
+    line[MAX_COMMAND_LENGTH + 1] = '\0';
+    assert_int_equal(parses(line), -1);
+
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        size_t length = lengths[i] + strlen(after);
+        char *input = malloc(length);
+        int results[8];
+        command last;
+
+        // a line of lengths[i] bytes with its \n, then a correct command
+        memset(input, 'E', lengths[i] - 1);
+        input[lengths[i] - 1] = '\n';
+        memcpy(input + lengths[i], after, strlen(after));
+
+        assert_int_equal(stream_results(input, length, results, 8, &last), 3);
+        assert_int_equal(results[0], -1);
+        assert_int_equal(results[1], 0);
+        assert_int_equal(last.opcode, OPCODE_MOVE);
+        assert_int_equal(last.data[3], 4);
+        assert_int_equal(results[2], COMMAND_STREAM_END);
+
+        // the same long line cut by the end of input
+        assert_int_equal(stream_results(input, lengths[i] - 1, results, 8, &last), 2);
+        assert_int_equal(results[0], -1);
+        assert_int_equal(results[1], COMMAND_STREAM_END);
+
+        free(input);
+    }
+}
+
+static uint64_t seed = 1;
+
+/**
+ * Next number of a splitmix64 generator.
+ */
+static uint64_t next_random() {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static int sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+static int count_units(board *game) {
+    int count = 0;
+    int p;
+    unit *u;
+    for (p = 1; p <= 2; p++) {
+        for (u = game_units(game, p); u != NULL; u = game_next_unit(game, u)) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Makes a random action of the player to move, usually a step towards the closest enemy,
+ * so that units fight, and sometimes a production or the end of the turn.
+ * @return result of the action, RESULT_WRONG_COMMAND when it is not allowed.
+ */
+static int make_random_action(board *game) {
+    int p = game_turn(game);
+    int units = 0;
+    int chosen;
+    unit *u;
+
+    if (next_random() % 8 == 0) {
+        return game_make_end_turn(game);
+    }
+
+    for (u = game_units(game, p); u != NULL; u = game_next_unit(game, u)) {
+        units++;
+    }
+    chosen = (int) (next_random() % units);
+    for (u = game_units(game, p); chosen > 0; u = game_next_unit(game, u)) {
+        chosen--;
+    }
+
+    int dx = (int) (next_random() % 3) - 1;
+    int dy = (int) (next_random() % 3) - 1;
+    switch (next_random() % 4) {
+        case 0:
+            return game_make_produce_peasant(game, u->x, u->y, u->x + dx, u->y + dy);
+        case 1:
+            return game_make_produce_knight(game, u->x, u->y, u->x + dx, u->y + dy);
+        default: {
+            unit *enemy = game_closest_unit(game, 3 - p, u->x, u->y);
+            return game_make_move(game, u->x, u->y, u->x + sign(enemy->x - u->x), u->y + sign(enemy->y - u->y));
+        }
+    }
+}
+
+/**
+ * Bytes of the live parts of a state, see `take_image`.
+ */
+typedef struct def_image {
+    unsigned char *bytes;
+    size_t length;
+    size_t capacity;
+} image;
+
+static void append(image *im, const void *data, size_t length) {
+    if (im->length + length > im->capacity) {
+        im->capacity = 2 * (im->length + length);
+        im->bytes = realloc(im->bytes, im->capacity);
+    }
+    memcpy(im->bytes + im->length, data, length);
+    im->length += length;
+}
+
+static void append_int(image *im, long long value) {
+    append(im, &value, sizeof(value));
+}
+
+static void append_unit(image *im, const unit *u) {
+    append_int(im, u->type);
+    append_int(im, u->x);
+    append_int(im, u->y);
+    append_int(im, u->idle_since);
+    append_int(im, u->ai_epoch);
+    append_int(im, u->id);
+    append_int(im, u->slot);
+    append_int(im, u->cell_prev);
+    append_int(im, u->cell_next);
+    append_int(im, u->prev);
+    append_int(im, u->next);
+}
+
+static void append_index(image *im, const unit_index *index) {
+    unsigned int i;
+
+    append_int(im, index->count);
+    if (index->kind == INDEX_GRID) {
+        append(im, index->grid, (size_t) index->size * index->size * sizeof(int));
+        return;
+    }
+    for (i = 0; i < index->capacity; i++) {
+        append_int(im, index->entries[i].value);
+        if (index->entries[i].value != INDEX_EMPTY) {
+            append_int(im, index->entries[i].x);
+            append_int(im, index->entries[i].y);
+        }
+    }
+}
+
+/**
+ * Writes the live parts of the state of the game: the units in the order of their lists, the index
+ * of positions, arrays and buckets of both players and the hash. Memory of dead units and of unused
+ * slots of the arrays is left out, as a production taken back gives its unit back to the pool.
+ */
+static void take_image(board *game, image *im) {
+    game_state *state = game->state;
+    int p;
+    unit *u;
+
+    im->length = 0;
+    append_int(im, state->turn);
+    append_int(im, state->number_of_rounds_left);
+    append_int(im, state->next_unit_id);
+    append_int(im, unit_pool_in_use(&state->pool));
+    append(im, &state->hash, sizeof(state->hash));
+
+    for (p = 0; p < 2; p++) {
+        player_units *pu = &state->units[p];
+
+        append_int(im, state->heads[p]);
+        for (u = game_units(game, p + 1); u != NULL; u = game_next_unit(game, u)) {
+            append_unit(im, u);
+        }
+
+        append_int(im, pu->count);
+        append(im, pu->x, pu->count * sizeof(int));
+        append(im, pu->y, pu->count * sizeof(int));
+        append(im, pu->type, pu->count * sizeof(char));
+        append(im, pu->idle_since, pu->count * sizeof(int));
+        append(im, pu->id, pu->count * sizeof(unsigned int));
+        append(im, pu->units, pu->count * sizeof(int));
+        append_index(im, &pu->cells);
+    }
+    append_index(im, &state->index);
+}
+
+static void assert_same_image(board *game, const image *expected) {
+    image now = {NULL, 0, 0};
+    take_image(game, &now);
+    assert_int_equal(now.length, expected->length);
+    assert_memory_equal(now.bytes, expected->bytes, now.length);
+    free(now.bytes);
+}
+
+/**
+ * Makes random legal actions on a board of size n with kings at (1, 1) and (1, 9), so that units
+ * meet and fight soon, and takes them back one by one. After every `game_unmake` the live parts of
+ * the state are the same byte for byte as before the action.
+ * @return number of actions killing units.
+ */
+static long make_unmake_walks(int n) {
+    static image before[WALK_ACTIONS];
+    board *game = game_create();
+    snapshot start = {NULL, 0, 0};
+    long kills = 0;
+    int walk, made, i;
+
+    assert_int_equal(game_init(game, n, 1000, 1, 1, 1, 1, 9), RESULT_ONGOING);
+    game_snapshot(game, &start);
+
+    for (walk = 0; walk < WALKS; walk++) {
+        int result = RESULT_ONGOING;
+        int attempts = 0;
+
+        game_restore(game, &start);
+        for (made = 0; made < WALK_ACTIONS && result == RESULT_ONGOING && attempts < ATTEMPTS; ) {
+            int units = count_units(game);
+            take_image(game, &before[made]);
+
+            result = make_random_action(game);
+            if (result == RESULT_WRONG_COMMAND) {
+                assert_same_image(game, &before[made]); // nothing is recorded either
+                result = RESULT_ONGOING;
+                attempts++;
+                continue;
+            }
+
+            kills += count_units(game) < units;
+            made++;
+            attempts = 0;
+        }
+
+        for (i = made - 1; i >= 0; i--) {
+            assert_int_equal(game_unmake(game), 0);
+            assert_same_image(game, &before[i]);
+        }
+        assert_int_equal(game_unmake(game), RESULT_WRONG_COMMAND);
+    }
+
+    for (i = 0; i < WALK_ACTIONS; i++) {
+        free(before[i].bytes);
+        before[i].bytes = NULL;
+        before[i].capacity = 0;
+    }
+    snapshot_free(&start);
+    game_destroy(game);
+    return kills;
+}
+
+/**
+ * Takes back actions on the smallest board, indexed by a grid, and on one indexed by a hash table.
+ */
+static void test_make_unmake(void **state) {
+    (void) state;
+
+    assert_true(make_unmake_walks(9) > 0);
+    assert_true(make_unmake_walks(100) > 0);
+}
+
+int main(void) {
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_correct_commands),
+        cmocka_unit_test(test_spaces),
+        cmocka_unit_test(test_number_range),
+        cmocka_unit_test(test_stream_number_range),
+        cmocka_unit_test(test_missing_newline),
+        cmocka_unit_test(test_long_lines),
+        cmocka_unit_test(test_make_unmake),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}